@@ -8,6 +8,7 @@
 #include "Time/RealTimer.hpp"
 #include "AtomicScope.hpp"
 #include "Tasks/TaskState.hpp"
+#include "Tasks/Coroutine.hpp"
 
 namespace DHT {
 
@@ -34,12 +35,16 @@ class DHT {
     datapin_t *pin;
     powerpin_t *power;
     DHTState state;
-    PulseCounter<comparator_t, datapin_t, 200> counter;
+    /** The longest pulse a DHT sends is 120us, so anything longer only needs to be detected as invalid. */
+    typedef PulseEncoding::Compact<PulseEncoding::unitPower2For(toCountsOn<comparator_t>(120_us).getValue())> encoding_t;
+
+    PulseCounter<comparator_t, datapin_t, 96, encoding_t> counter;
     VariableDeadline<rt_t> timeout;
-    uint8_t bit = 7;
+    Coroutine co = { false };
+    PulseOn<comparator_t> pulse;
+    uint8_t bit = 0;
     uint8_t pos = 0;
-    uint8_t data[4] = { 0, 0, 0, 0 };
-    bool seenHigh = false;
+    uint8_t data[5] = { 0, 0, 0, 0, 0 };
     uint8_t lastFailure = -1;
 
 public:
@@ -47,6 +52,7 @@ public:
     	AtomicScope _;
         power->setLow();
         state = DHTState::OFF;
+        co.stop();
     }
 
     void powerOn() {
@@ -57,6 +63,7 @@ public:
             power->setHigh();
             timeout.schedule(1_s);
             state = DHTState::BOOTING;
+            co.restart();
         }
     }
 
@@ -70,6 +77,7 @@ public:
             pin->setLow();
             timeout.schedule(18_ms);
             state = DHTState::SIGNALING;
+            co.restart();
         } else {
             log::debug(F("Still booting, or measurement already in progress."));
             lastFailure = 253;
@@ -86,107 +94,23 @@ private:
         lastFailure = failure;
         pin->configureAsInputWithPullup();
         state = DHTState::IDLE;
-        bit = 7;
-        pos = 0;
-        seenHigh = false;
         counter.pause();
     }
 
-    void receive(bool value) {
-    	log::debug('0' + value);
-        if (value) {
-            data[pos] |= (1 << bit);
-        } else {
-            data[pos] &= ~(1 << bit);
-        }
-        if (bit > 0) {
-            bit--;
-        } else {
-            bit = 7;
-            log::debug(F("in "), dec(data[pos]));
-            pos++;
-        }
-        if (pos >= 5) {
-            reset(0);
+    /** Reads the next pulse into [pulse]. On a timeout, resets with the current state as failure, and returns false. */
+    bool readPulse() {
+        counter.on([this] (auto p) {
+            pulse = p;
+        });
+        log::debug(dec(uint8_t(state)), ':', as<Pulse::TEXT>(&pulse));
+        if (pulse.isEmpty()) {
+            reset(uint8_t(state));
+            return false;
         } else {
-            state = DHTState::RECEIVING_LOW;
-        }
-    }
-
-    void booting() {
-        if (timeout.isNow()) {
-        	log::debug(F("Done booting"));
-        	state = DHTState::IDLE;
-        }
-    }
-
-    void signaling() {
-        if (timeout.isNow()) {
-            log::debug(F("Switching to input"));
-            pin->configureAsInputWithPullup();
-            counter.resume();
-            state = DHTState::SYNC_LOW;
+            return true;
         }
     }
 
-    template <typename f_t>
-    void expectPulse(f_t f) {
-        counter.on([this, f] (auto pulse) {
-            log::debug(dec(uint8_t(state)), ':', as<Pulse::TEXT>(&pulse));
-            if (pulse.isEmpty()) {
-                this->reset(uint8_t(state));
-            } else {
-                f(pulse);
-            }
-        });
-    }
-
-    void sync_low() {
-        expectPulse([this] (auto pulse) {
-            if (pulse.isLow() && pulse > 60_us && pulse < 120_us) {
-                state = DHTState::SYNC_HIGH;
-            } else {
-            	log::debug(F("Ignoring "));
-            }
-        });
-    }
-
-    void sync_high() {
-        expectPulse([this] (auto pulse) {
-            if (pulse.isHigh() && pulse > 60_us && pulse < 120_us) {
-                state = DHTState::RECEIVING_LOW;
-            }
-        });
-    }
-
-    void receiving_low() {
-        expectPulse([this] (auto pulse) {
-            if (pulse.isLow()) {
-                if (pulse > 30_us && pulse < 80_us) {
-                    state = DHTState::RECEIVING_HIGH;
-                } else {
-                    this->reset(pulse.getDuration());
-                }
-            } else {
-                this->reset(43);
-            }
-        });
-    }
-
-    void receiving_high() {
-        expectPulse([this] (auto pulse) {
-            if (pulse.isHigh()) {
-                if (pulse < 50_us) {
-                    this->receive(0);
-                } else {
-                    this->receive(1);
-                }
-            } else {
-                this->reset(44);
-            }
-        });
-    }
-
 public:
     typedef Delegate<This, decltype(counter), &This::counter> Handlers;
 
@@ -203,40 +127,69 @@ public:
     }
 
     void loop() {
-        switch(state) {
-        case DHTState::OFF: break;
-        case DHTState::IDLE: break;
-        case DHTState::BOOTING: booting(); break;
-        case DHTState::SIGNALING: signaling(); break;
-        case DHTState::SYNC_LOW: sync_low(); break;
-        case DHTState::SYNC_HIGH: sync_high(); break;
-        case DHTState::RECEIVING_LOW: receiving_low(); break;
-        case DHTState::RECEIVING_HIGH: receiving_high(); break;
+        AVR_CO_BEGIN(co);
+
+        // Either booting, or signaling the start of a measurement
+        AVR_CO_AWAIT_DEADLINE(co, timeout, SleepMode::POWER_DOWN);
+        if (state == DHTState::BOOTING) {
+            log::debug(F("Done booting"));
+            state = DHTState::IDLE;
+            AVR_CO_EXIT(co);
         }
-    }
 
-    /**
-     * Returns the approximate time left until any ongoing measurement completes,
-     * or 0xFFFFFFFF if no measurement is in progress.
-     */
-    Microseconds timeLeft() const {
-    	if (state == DHTState::BOOTING || state == DHTState::OFF || state == DHTState::IDLE) {
-    		return 0xFFFFFFFF;
-    	} else {
-    		return 30;
-    	}
+        log::debug(F("Switching to input"));
+        pin->configureAsInputWithPullup();
+        counter.resume();
+
+        state = DHTState::SYNC_LOW;
+        do {
+            AVR_CO_AWAIT(co, counter.hasPulses(), SleepMode::IDLE);
+            if (!readPulse()) AVR_CO_EXIT(co);
+        } while (!(pulse.isLow() && pulse > 60_us && pulse < 120_us));
+
+        state = DHTState::SYNC_HIGH;
+        do {
+            AVR_CO_AWAIT(co, counter.hasPulses(), SleepMode::IDLE);
+            if (!readPulse()) AVR_CO_EXIT(co);
+        } while (!(pulse.isHigh() && pulse > 60_us && pulse < 120_us));
+
+        for (pos = 0; pos < 5; pos++) {
+            for (bit = 0; bit < 8; bit++) {
+                state = DHTState::RECEIVING_LOW;
+                AVR_CO_AWAIT(co, counter.hasPulses(), SleepMode::IDLE);
+                if (!readPulse()) AVR_CO_EXIT(co);
+                if (!pulse.isLow()) {
+                    reset(43);
+                    AVR_CO_EXIT(co);
+                }
+                if (!(pulse > 30_us && pulse < 80_us)) {
+                    reset(pulse.getDuration());
+                    AVR_CO_EXIT(co);
+                }
+
+                state = DHTState::RECEIVING_HIGH;
+                AVR_CO_AWAIT(co, counter.hasPulses(), SleepMode::IDLE);
+                if (!readPulse()) AVR_CO_EXIT(co);
+                if (!pulse.isHigh()) {
+                    reset(44);
+                    AVR_CO_EXIT(co);
+                }
+                log::debug((pulse < 50_us) ? '0' : '1');
+                data[pos] = (data[pos] << 1) | ((pulse < 50_us) ? 0 : 1);
+            }
+            log::debug(F("in "), dec(data[pos]));
+        }
+        reset(0);
+
+        AVR_CO_END(co);
     }
 
     DHTState getState() const {
         return state;
     }
 
-    auto getTaskState() const {
-    	if (isIdle()) {
-    		return TaskState::idle();
-    	} else {
-    		return TaskState::busy(timeLeft(), SleepMode::POWER_DOWN);
-    	}
+    TaskState getTaskState() const {
+        return co.getTaskState(timeout);
     }
 
     bool isIdle() const {
@@ -17,8 +17,8 @@ using namespace Streams;
 using namespace Serial;
 
 struct FS20Packet {
-    static const uint8_t prefix[];
-    static const uint8_t postfix[];
+    static constexpr uint8_t prefix[] = { 0b00000000, 0b00000000, 0b10000000 };
+    static constexpr uint8_t postfix[] = { 0b00, };
 
     template <typename prescaled_t>
     static constexpr SerialConfig serialConfig() {
@@ -36,6 +36,12 @@ struct FS20Packet {
             postfix, 2 };
     }
 
+    /** The serial config on timer [prescaled_t], for StaticSerialConfig. */
+    template <typename prescaled_t>
+    struct SerialFormat {
+        static constexpr SerialConfig serialconfig = serialConfig<prescaled_t>();
+    };
+
     uint8_t houseCodeHi = 0;
     uint8_t houseCodeLo = 0;
     uint8_t address = 0;
@@ -67,6 +73,9 @@ struct FS20Packet {
     > DefaultProtocol;
 };
 
+template <typename prescaled_t>
+constexpr SerialConfig FS20Packet::SerialFormat<prescaled_t>::serialconfig;
+
 }
 
 #endif /* FS20PACKET_HPP_ */
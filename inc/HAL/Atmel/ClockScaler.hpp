@@ -0,0 +1,116 @@
+#pragma once
+
+#include "HAL/Atmel/Device.hpp"
+#include "AtomicScope.hpp"
+#include "Logging.hpp"
+#include <gcc_type_traits.h>
+
+namespace HAL {
+namespace Atmel {
+
+namespace Impl {
+
+/**
+ * Performs the timed CLKPR change sequence, running the system clock at F_CPU / 2^power2.
+ * Interrupts are disabled during the sequence, and restored to their previous state afterwards.
+ */
+void setClockDivider(uint8_t power2);
+
+}
+
+/**
+ * Lowers the system clock through CLKPR while only low-rate work is pending, e.g. while waiting
+ * for a sensor conversion or a slow network response.
+ *
+ * The real timer's timer is switched to a prescaler that is 2^divisorPower2 smaller in lockstep,
+ * so it keeps counting at the same rate. Hence, counts(), ticks(), millis(), and any deadlines and
+ * comparators on that timer stay correct while scaled. A switch introduces at most one count
+ * of jitter. Busy-wait delays (e.g. _delay_us) will of course take 2^divisorPower2 longer.
+ *
+ * Scaling is refused while any peripheral that derives its timing from the system clock is busy:
+ *   - the USART is receiving, or transmitting
+ *   - SPI or TWI is enabled
+ *   - any timer other than the real timer's is running, e.g. for a PulseCounter or PWM.
+ *
+ * divisorPower2 must be chosen such that the resulting timer prescaler exists, e.g. on a real timer
+ * with prescaler 64, a divisorPower2 of 3 (running the timer at prescaler 8) or 6 (prescaler 1).
+ */
+template <typename rt_t, uint8_t divisorPower2>
+class ClockScaler {
+    typedef Logging::Log<Loggers::Power> log;
+    typedef typename rt_t::timer_t::timer_info_t timer_info_t;
+
+    static_assert(divisorPower2 > 0 && divisorPower2 <= 8, "CLKPR can divide the system clock by 2^1 to 2^8");
+    static_assert(divisorPower2 <= rt_t::prescalerPower2, "The real timer's prescaler must be at least 2^divisorPower2");
+
+    static constexpr auto fullPrescaler = rt_t::prescaler;
+    // Fails to compile if the timer has no prescaler of this value
+    static constexpr auto scaledPrescaler = timer_info_t::template PrescalerFromInt<(1 << (rt_t::prescalerPower2 - divisorPower2))>::value;
+
+    bool scaled = false;
+
+    template <typename info>
+    static bool isOtherTimerRunning() {
+        return !std::is_same<info, timer_info_t>::value && info::isRunning();
+    }
+
+    static bool isUsartBusy() {
+        return RXEN0.isSet() || UDRIE0.isSet() || (TXEN0.isSet() && TXC0.isCleared());
+    }
+
+public:
+    /**
+     * Returns whether any peripheral currently relies on the system clock running at F_CPU.
+     */
+    static bool needsExactClock() {
+        return isUsartBusy() || SPE.isSet() || TWEN.isSet() ||
+               isOtherTimerRunning<Info::Timer0Info>() ||
+               isOtherTimerRunning<Info::Timer1Info>() ||
+               isOtherTimerRunning<Info::Timer2Info>();
+    }
+
+    /**
+     * Runs the system clock at F_CPU / 2^divisorPower2, if no peripheral needs exact timing.
+     * Returns whether the clock is now scaled.
+     */
+    bool scaleDown() {
+        if (scaled) {
+            return true;
+        }
+        if (needsExactClock()) {
+            log::debug(F("Clock scaling refused"));
+            return false;
+        }
+        AtomicScope _;
+        timer_info_t::setPrescaler(scaledPrescaler);
+        Impl::setClockDivider(divisorPower2);
+        scaled = true;
+        return true;
+    }
+
+    /**
+     * Runs the system clock at F_CPU again. Must be called before starting any work that needs
+     * exact timing.
+     */
+    void scaleUp() {
+        if (!scaled) {
+            return;
+        }
+        AtomicScope _;
+        Impl::setClockDivider(0);
+        timer_info_t::setPrescaler(fullPrescaler);
+        scaled = false;
+    }
+
+    bool isScaled() const {
+        return scaled;
+    }
+};
+
+template <uint8_t divisorPower2, typename rt_t>
+ClockScaler<rt_t, divisorPower2> clockScaler(rt_t &rt) {
+    return ClockScaler<rt_t, divisorPower2>();
+}
+
+}
+}
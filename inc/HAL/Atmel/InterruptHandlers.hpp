@@ -1,14 +1,40 @@
 #ifndef HAL_ATMEL_INTERRUPTHANDLERS_HPP_
 #define HAL_ATMEL_INTERRUPTHANDLERS_HPP_
 
+#include <stdint.h>
 #include "gcc_type_traits.h"
 #include "FOREACH.h"
 
 namespace HAL {
 namespace Atmel {
 
+namespace InterruptHandlers {
+    /**
+     * Whether the interrupt handlers of T set a wake flag for event-driven tasks (see loopTasks()). Specialize
+     * this as std::true_type for each class whose handlers a task names in its WakeOn typedef, e.g.
+     *
+     *     template <> struct WakesTasks<MyDriver>: public std::true_type {};
+     *
+     * Handlers of all other classes don't pay for the flag.
+     */
+    template <typename T>
+    struct WakesTasks: public std::false_type {};
+}
+
 namespace Impl {
 
+/**
+ * Set whenever an interrupt handler on an instance of T has been invoked, if WakesTasks<T>. This allows
+ * event-driven tasks to only have their loop() invoked when something has happened, see loopTasks().
+ */
+template <typename T>
+struct WakeFlag {
+    static volatile bool pending;
+};
+
+template <typename T>
+volatile bool WakeFlag<T>::pending = false;
+
 template <typename I>
 struct HardwareInt {
     typedef I INT;
@@ -27,6 +53,14 @@ struct EmptyHandlers {
 
         static __attribute__((always_inline)) inline void invoke(T &t) {}
     };
+
+    template <typename V>
+    using Handles = std::false_type;
+
+    static __attribute__((always_inline)) inline bool isWakePending() { return false; }
+    static __attribute__((always_inline)) inline void clearWakeFlags() {}
+    static constexpr bool hasHandlers() { return false; }
+    static constexpr bool hasWakeFlags() { return false; }
 };
 
 template <typename I, typename T, void (T::*f)(), typename P, typename V, typename check=void>
@@ -43,6 +77,9 @@ struct On_Handler<I,T,f,P,V,typename std::enable_if<std::is_same<V, typename I::
         I::wrap([t_ptr] () __attribute__((always_inline)) {
             (t_ptr->*f)();
         });
+        if (InterruptHandlers::WakesTasks<T>::value) {
+            WakeFlag<T>::pending = true;
+        }
         P::template Handler<V>::invoke(t);
     }
 };
@@ -54,6 +91,13 @@ struct On_Handler<I,T,f,P,V,typename std::enable_if<std::is_same<V, typename I::
  * "Handlers" should be an alias to chained "On" and "Delegate" types.
  */
 namespace InterruptHandlers {
+    /**
+     * A handler chain that doesn't bind to any interrupt, e.g. to declare a task that is only woken up
+     * by its own deadlines (see loopTasks).
+     */
+    template <typename T>
+    using NoHandlers = Impl::EmptyHandlers<T>;
+
     /**
      * Defines a single interrupt handler.
      * @param T This-type of the class defining the interrupt handler
@@ -65,6 +109,27 @@ namespace InterruptHandlers {
     struct On: public P {
         template <typename V>
         using Handler = Impl::On_Handler<I,T,f,P,V>;
+
+        /** Whether this handler chain binds to interrupt vector V */
+        template <typename V>
+        using Handles = std::integral_constant<bool, std::is_same<V, typename I::INT>::value || P::template Handles<V>::value>;
+
+        /** Whether any handler in this chain that sets a wake flag has been invoked since the last clearWakeFlags() */
+        static __attribute__((always_inline)) inline bool isWakePending() {
+            return (WakesTasks<T>::value && Impl::WakeFlag<T>::pending) || P::isWakePending();
+        }
+
+        static __attribute__((always_inline)) inline void clearWakeFlags() {
+            if (WakesTasks<T>::value) {
+                Impl::WakeFlag<T>::pending = false;
+            }
+            P::clearWakeFlags();
+        }
+
+        static constexpr bool hasHandlers() { return true; }
+
+        /** Whether any handler in this chain sets a wake flag, see WakesTasks */
+        static constexpr bool hasWakeFlags() { return WakesTasks<T>::value || P::hasWakeFlags(); }
     };
 
     /**
@@ -85,6 +150,22 @@ namespace InterruptHandlers {
                 P::template Handler<I>::invoke(t);
             }
         };
+
+        /** Whether this handler chain, or the one of the delegated-to member, binds to interrupt vector V */
+        template <typename V>
+        using Handles = std::integral_constant<bool, U::Handlers::template Handles<V>::value || P::template Handles<V>::value>;
+
+        static __attribute__((always_inline)) inline bool isWakePending() {
+            return U::Handlers::isWakePending() || P::isWakePending();
+        }
+
+        static __attribute__((always_inline)) inline void clearWakeFlags() {
+            U::Handlers::clearWakeFlags();
+            P::clearWakeFlags();
+        }
+
+        static constexpr bool hasHandlers() { return U::Handlers::hasHandlers() || P::hasHandlers(); }
+        static constexpr bool hasWakeFlags() { return U::Handlers::hasWakeFlags() || P::hasWakeFlags(); }
     };
 };
 
@@ -115,6 +196,9 @@ mkINTS(
         PCINT1_, \
         PCINT2_)
 
+// FOR_EACH goes up to 20 arguments
+mkINT(TIMER1_CAPT_)
+
 #ifdef AVR
 #define __INTR_ATTRS signal, used, externally_visible
 #define __INTR_EXTERN extern "C"
@@ -126,7 +210,9 @@ mkINTS(
 #define mkISR(name, N) \
     __INTR_EXTERN void __vector_ ## N (void) __attribute__ ((__INTR_ATTRS)); \
     void __vector_ ## N (void) { \
-        decltype(app)::Handlers::Handler < ::HAL::Atmel::Int_##name##_ >::invoke(app); \
+        ::HAL::Atmel::Impl::InterruptTracer<>::wrap<N>([] () __attribute__((always_inline)) { \
+            decltype(app)::Handlers::Handler < ::HAL::Atmel::Int_##name##_ >::invoke(app); \
+        }); \
     } \
     inline void name ## _vect() { \
         __vector_ ## N (); \
@@ -139,10 +225,12 @@ mkINTS(
  * - A typedef "Handlers" aliasing an {@link InterruptHandlers::On} or {@link InterruptHandlers::Delegate} type,
  *   to define interrupt handlers.
  * - A void method main(), which will become the main function.
+ *
+ * Before invoking main(), all peripherals that the app doesn't use are powered down, see gateUnusedPeripherals().
  */
 #define RUN_APP(type) \
     type app; \
-    int main() { app.main(); } \
+    int main() { ::HAL::Atmel::gateUnusedPeripherals<type::Handlers>(); app.main(); } \
     mkISRS \
 
 }
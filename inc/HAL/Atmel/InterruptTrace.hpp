@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+#include "HAL/Atmel/Registers.hpp"
+#include "AtomicScope.hpp"
+#include "Logging.hpp"
+
+namespace HAL {
+namespace Atmel {
+
+/** Entry and exit statistics of one interrupt vector, in TCNT1 counts */
+struct VectorTrace {
+    uint16_t count;
+    /** Longest time spent in the vector, including any vectors nested inside it. */
+    uint16_t max;
+    uint32_t total;
+    /** Number of times the vector was entered while another traced vector was still running. */
+    uint16_t nested;
+    /** Number of times the vector was entered within backToBackCounts of another vector's exit. */
+    uint16_t backToBack;
+};
+
+namespace Impl {
+
+/** Vectors __vector_0 (reset) up to __vector_25 of the ATmega328 */
+constexpr uint8_t tracedVectors = 26;
+
+/**
+ * Maximum TCNT1 counts between the exit of one vector and the entry of the next to consider them back-to-back,
+ * i.e. the second interrupt was already pending when the first one returned. This covers the interrupt response
+ * and the register save and restore of both vectors, with timer 1 on prescaler 1.
+ */
+constexpr uint16_t backToBackCounts = 64;
+
+/**
+ * Timestamps entry and exit of every __vector_N generated by mkISR with TCNT1, enabled by turning on timing for
+ * Loggers::Interrupts in LoggingSettings.hpp. Timer 1 must be running (with prescaler 1 to measure cycles), and
+ * individual samples are limited to 65535 counts. When disabled, this compiles to nothing.
+ */
+template <bool enabled = Logging::Log<Loggers::Interrupts>::isTimingEnabled()>
+struct InterruptTracer {
+    static VectorTrace vectors[tracedVectors];
+    static uint8_t depth;
+    static bool hasExited;
+    static uint16_t lastExit;
+
+    template <uint8_t N, typename body_t>
+    static __attribute__((always_inline)) inline void wrap(body_t body) {
+        static_assert(N < tracedVectors, "Vector number out of range");
+        const uint16_t start = Registers::TCNT1.get();
+        VectorTrace &v = vectors[N];
+        if (depth > 0) {
+            v.nested++;
+        } else if (hasExited && uint16_t(start - lastExit) <= backToBackCounts) {
+            v.backToBack++;
+        }
+        depth++;
+        body();
+        depth--;
+        const uint16_t end = Registers::TCNT1.get();
+        const uint16_t duration = end - start;
+        if (v.count < 0xFFFF) {
+            v.count++;
+            v.total += duration;
+        }
+        if (duration > v.max) {
+            v.max = duration;
+        }
+        lastExit = end;
+        hasExited = true;
+    }
+
+    static VectorTrace get(uint8_t vector) {
+        AtomicScope _;
+        return vectors[vector];
+    }
+
+    static void clear() {
+        AtomicScope _;
+        for (uint8_t i = 0; i < tracedVectors; i++) {
+            vectors[i] = {};
+        }
+        hasExited = false;
+    }
+
+    template <typename fifo_t>
+    static void write(fifo_t &out) {
+        using Streams::dec;
+        for (uint8_t i = 0; i < tracedVectors; i++) {
+            const VectorTrace v = get(i);
+            if (v.count > 0) {
+                out.write(F("V"), dec(i), F(" n="), dec(v.count), F(" max="), dec(v.max), F(" total="), dec(v.total),
+                          F(" nested="), dec(v.nested), F(" b2b="), dec(v.backToBack), F("\r\n"));
+            }
+        }
+    }
+};
+
+template <bool enabled>
+VectorTrace InterruptTracer<enabled>::vectors[tracedVectors];
+
+template <bool enabled>
+uint8_t InterruptTracer<enabled>::depth = 0;
+
+template <bool enabled>
+bool InterruptTracer<enabled>::hasExited = false;
+
+template <bool enabled>
+uint16_t InterruptTracer<enabled>::lastExit = 0;
+
+template <>
+struct InterruptTracer<false> {
+    template <uint8_t N, typename body_t>
+    static __attribute__((always_inline)) inline void wrap(body_t body) {
+        body();
+    }
+
+    inline static VectorTrace get(uint8_t vector) { return {}; }
+    inline static void clear() {}
+
+    template <typename fifo_t>
+    inline static void write(fifo_t &out) {}
+};
+
+} // namespace Impl
+
+/**
+ * Returns the traced statistics of interrupt vector [vector], i.e. the N in __vector_N. Always empty unless timing
+ * is enabled for Loggers::Interrupts.
+ */
+inline VectorTrace getInterruptTrace(uint8_t vector) {
+    return Impl::InterruptTracer<>::get(vector);
+}
+
+/**
+ * Writes one line for every traced interrupt vector that has been invoked to [out], e.g. a Fifo or a UART's
+ * transmit pin, with its invocation count, maximum and total TCNT1 counts, and the number of times it was
+ * nested in, or ran directly after, another vector.
+ */
+template <typename fifo_t>
+void writeInterruptTrace(fifo_t &out) {
+    Impl::InterruptTracer<>::write(out);
+}
+
+/** Resets the statistics of all traced interrupt vectors. */
+inline void clearInterruptTrace() {
+    Impl::InterruptTracer<>::clear();
+}
+
+} // namespace Atmel
+} // namespace HAL
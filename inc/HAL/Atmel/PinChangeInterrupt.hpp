@@ -25,9 +25,12 @@ class PinChangeSupport {
     static void enablePCINT() {
         AtomicScope _;
 
-
-        if (pcintInfo::PCIE.isCleared()) {
+        // The pin may have changed while it was masked, even if other pins kept PCIE enabled, so compare
+        // the next interrupt against its current level.
+        if (pcintInfo::PCIE.isCleared() || (pcintInfo::PCMSK.get() & bitmask) == 0) {
             last = pcintInfo::PIN.get();
+        }
+        if (pcintInfo::PCIE.isCleared()) {
             pcintInfo::PCIE.set();
         }
     }
@@ -49,6 +52,7 @@ public:
     	//ints++;
         uint8_t now = pcintInfo::PIN.val();
         if (shouldInvoke(now)) {
+            Logging::event<log>(Logging::Event::PIN_CHANGE, (uint16_t(bitmask) << 8) | now);
             body();
         }
         last = now;
@@ -144,8 +148,11 @@ class PinChangeVectorOnChange {
     static void enablePCINT() {
         AtomicScope _;
 
-        if (pcintInfo::PCIE.isCleared()) {
+        // See PinChangeSupport::enablePCINT()
+        if (pcintInfo::PCIE.isCleared() || (pcintInfo::PCMSK.get() & bitmask) == 0) {
             last = pcintInfo::PIN.get();
+        }
+        if (pcintInfo::PCIE.isCleared()) {
             pcintInfo::PCIE.set();
         }
     }
@@ -48,13 +48,55 @@ namespace Impl {
  */
 void sleep(SleepMode mode);
 
-template <typename rt_t>
+/**
+ * Interrupt handler that wakes up tickless IDLE sleep: comparator B of the real timer's timer, see Power.
+ */
+template <typename power_t, typename rt_t, bool tickless>
+struct TicklessWakeup {
+    typedef EmptyHandlers<power_t> Handlers;
+};
+
+template <typename power_t, typename rt_t>
+struct TicklessWakeup<power_t, rt_t, true> {
+    typedef typename rt_t::timer_t::comparatorB_t comparator_t;
+    typedef On<power_t, typename comparator_t::INT, &power_t::onTicklessWakeup> Handlers;
+};
+
+/**
+ * Manages sleep of the microcontroller, keeping the real timer [rt_t] in sync.
+ *
+ * With [tickless], IDLE sleep doesn't wake up on every real timer overflow (about every 1ms for an 8-bit timer
+ * with prescaler 64), but only once the requested time has passed or another interrupt has fired. To do so, the
+ * real timer's timer runs at prescaler 1024 with its overflow interrupt off while sleeping, and comparator B of
+ * that timer (which must be in normal mode) wakes us up at the deadline. Hence:
+ *   - comparator B of the real timer's timer must not be used for anything else,
+ *   - interrupt handlers should not read the real timer during IDLE sleep, since it's only brought up to date
+ *     on wakeup. Every tickless sleep introduces at most one count of the slow prescaler in jitter.
+ * Only use this if no task relies on being polled on every timer tick, i.e. all tasks report their deadlines
+ * through getTaskState().
+ */
+template <typename rt_t, bool tickless = false>
 class Power {
-    typedef Power<rt_t> This;
+    typedef Power<rt_t, tickless> This;
     typedef Logging::Log<Loggers::Power> log;
 
+    template <typename, typename, bool> friend struct TicklessWakeup;
+
+    /** Nominal length of the shortest watchdog interval (16ms), in 1/16 ms. */
+    static constexpr uint16_t nominalWatchdogPeriod = 256;
+    /** Re-calibrate the watchdog after having slept this many milliseconds since the last calibration. */
+    static constexpr uint32_t recalibrationInterval = 3600000;
+    /** Re-calibrate the watchdog when the supply voltage has changed by more than this many mV. */
+    static constexpr uint16_t recalibrationVoltageDelta = 100;
+
     rt_t *rt;
     volatile uint8_t _watchdogCounter;
+    /** Measured length of the shortest watchdog interval, in 1/16 ms. */
+    uint16_t watchdogPeriod = nominalWatchdogPeriod;
+    /** Starts out at recalibrationInterval, so the first deep sleep calibrates the watchdog. */
+    uint32_t sleptSinceCalibration = recalibrationInterval;
+    uint16_t calibrationVoltage = 0;
+    volatile bool ticklessWoken = false;
 
     void setWatchdogInterrupts (int8_t mode) {
         WDTCSR_t wdtcsr { ~(WDP0 | WDP1 | WDP2 | WDE | WDCE | WDP3 | WDIE | WDIF) };
@@ -78,7 +120,106 @@ class Power {
         _watchdogCounter++;
     }
 
+    /**
+     * Returns the actual length of the watchdog interval for the given [wdp] setting, in milliseconds.
+     */
+    uint32_t watchdogInterval(uint8_t wdp) const {
+        return (uint32_t(watchdogPeriod) << wdp) >> 4;
+    }
+
+    /**
+     * Sleeps in IDLE mode (in which the real timer keeps running) until the next watchdog interrupt,
+     * or until [timeout] counts have passed since [start]. Returns whether the watchdog fired.
+     */
+    bool awaitWatchdog(uint32_t start, uint32_t timeout) {
+        const uint8_t count = _watchdogCounter;
+        while (_watchdogCounter == count) {
+            if (uint32_t(rt->counts()) - start > timeout) {
+                return false;
+            }
+            sleep(SleepMode::IDLE);
+        }
+        return true;
+    }
+
+    void onTicklessWakeup() {
+        ticklessWoken = true;
+    }
+
+    /**
+     * Sleeps in IDLE mode for the given time, with the real timer's timer slowed down to prescaler 1024 and
+     * its overflow interrupt off. A compare match wakes us up at the end, or after at most one slow timer period,
+     * after which we go back to sleep. The skipped ticks are credited to the real timer on return.
+     * Returns whether any other interrupt has woken us up.
+     */
+    template <bool t = tickless>
+    typename std::enable_if<t, bool>::type doSleepTickless(Milliseconds ms) {
+        typedef typename rt_t::timer_t timer_t;
+        typedef typename timer_t::timer_info_t timer_info_t;
+        typedef typename TicklessWakeup<This, rt_t, true>::comparator_t comparator_t;
+        typedef typename comparator_t::comparator_info_t comparator_info_t;
+        typedef typename timer_t::value_t value_t;
+        static_assert(rt_t::prescalerPower2 < 10, "Tickless sleep needs a real timer with a prescaler below 1024");
+        constexpr uint8_t slowdownPower2 = 10 - rt_t::prescalerPower2;
+        constexpr auto slowPrescaler = timer_info_t::template PrescalerFromInt<1024>::value;
+
+        const uint32_t delay = toCountsOn<rt_t>(ms).getValue() >> slowdownPower2;
+        if (delay == 0) {
+            return false;
+        }
+
+        uint32_t start;
+        value_t last;
+        {
+            AtomicScope _;
+            start = rt->counts();
+            rt->timer->interruptOnOverflowOff();
+            timer_info_t::setPrescaler(slowPrescaler);
+            last = timer_info_t::TCNT.val();
+        }
+
+        bool interrupted = false;
+        uint32_t elapsed = 0;
+        while (elapsed < delay) {
+            const uint32_t left = delay - elapsed;
+            {
+                AtomicScope _;
+                comparator_info_t::OCR.val() = value_t(last + ((left > timer_t::maximum) ? timer_t::maximum : left));
+                ticklessWoken = false;
+                comparator_t::interruptOn();
+            }
+            sleep(SleepMode::IDLE);
+            AtomicScope _;
+            comparator_t::interruptOff();
+            const value_t now = timer_info_t::TCNT.val();
+            elapsed += value_t(now - last);
+            last = now;
+            if (!ticklessWoken) {
+                interrupted = true;
+                break;
+            }
+        }
+
+        AtomicScope _;
+        elapsed += value_t(timer_info_t::TCNT.val() - last);
+        timer_info_t::setPrescaler(rt_t::prescaler);
+        const uint32_t end = start + (elapsed << slowdownPower2);
+        timer_info_t::TCNT.val() = value_t(end);
+        rt->haveSlept(Ticks((end >> timer_t::maximumPower2) - rt->_ticks));
+        rt->timer->interruptOnOverflowOn();
+        return interrupted;
+    }
+
+    template <bool t = tickless>
+    typename std::enable_if<!t, bool>::type doSleepTickless(Milliseconds ms) {
+        return false;
+    }
+
     bool doSleepFor(Milliseconds ms, SleepMode mode, SleepGranularity maxGranularity) {
+        if (tickless && mode == SleepMode::IDLE) {
+            return doSleepTickless(ms);
+        }
+
     	log::debug(F("Z: "), dec(ms.getValue()), F("ms in "), '0' + uint8_t(mode));
 
         if (mode != SleepMode::IDLE) {
@@ -91,20 +232,31 @@ class Power {
             return false;
         }
 
+        if (mode != SleepMode::IDLE && sleptSinceCalibration >= recalibrationInterval) {
+            const uint32_t start = rt->counts();
+            calibrate();
+            // calibration has already spent part of our time in IDLE, where the real timer keeps running
+            const uint32_t spent = toMillisOn<rt_t>(Counts(uint32_t(rt->counts()) - start)).getValue();
+            if (millisSleep <= spent + 16) {
+                return false;
+            }
+            millisSleep -= spent;
+        }
+
         uint32_t msleft = millisSleep;
         // only slow down for periods longer than the watchdog granularity
-        while (msleft >= 16) {
+        while (msleft >= watchdogInterval(0)) {
             uint8_t wdp = 0; // wdp 0..9 corresponds to roughly 16..8192 ms
-            // calc wdp as log2(msleft/16), i.e. loop & inc while next value is ok
-            for (uint32_t m = msleft; m >= 32; m >>= 1)
-                if (++wdp >= uint8_t(maxGranularity))
-                    break;
+            // calc wdp as the longest (calibrated) watchdog interval that still fits in msleft
+            while (wdp < uint8_t(maxGranularity) && watchdogInterval(wdp + 1) <= msleft) {
+                wdp++;
+            }
             _watchdogCounter = 0;
             setWatchdogInterrupts(wdp);
             sleep(mode);
             setWatchdogInterrupts(-1); // off
             // when interrupted, our best guess is that half the time has passed
-            uint32_t halfms = 8 << wdp;
+            uint32_t halfms = watchdogInterval(wdp) / 2;
             msleft -= halfms;
             if (_watchdogCounter == 0) {
                 interrupted = true; // lost some time, but got interrupted
@@ -117,6 +269,7 @@ class Power {
             // adjust ticks for the delay we've just had. Not for IDLE, since timers keep running
             // there.
             millisSleep -= msleft;
+            sleptSinceCalibration += millisSleep;
             auto ms = Milliseconds(millisSleep);
             rt->haveSlept(ms);
         }
@@ -140,10 +293,68 @@ class Power {
     }
 
 public:
-    typedef On<This, Int_WDT_, &This::onWatchdog> Handlers;
+    typedef On<This, Int_WDT_, &This::onWatchdog, typename TicklessWakeup<This, rt_t, tickless>::Handlers> Handlers;
 
     Power(rt_t &_rt): rt(&_rt) {}
 
+    /**
+     * Measures the length of one watchdog interval against the real timer, and uses the result to
+     * correct the watchdog-based sleep durations of sleepFor() and friends. The watchdog oscillator can deviate
+     * 10% or more from its nominal frequency, depending on temperature and supply voltage.
+     *
+     * Calibration takes about 2 watchdog intervals (32ms), during which the CPU is in IDLE sleep.
+     * It is also performed automatically before the first deep sleep, after having slept for an hour, and after
+     * onSupplyVoltage() has reported a significant change. That time is then taken off the requested sleep.
+     *
+     * Returns whether the calibration succeeded. If not, the previous calibration remains in effect.
+     */
+    bool calibrate() {
+        sleptSinceCalibration = 0;
+        const uint32_t nominal = toCountsOn<rt_t>(16_ms).getValue();
+        const uint32_t timeout = nominal * 4;
+
+        _watchdogCounter = 0;
+        setWatchdogInterrupts(0);
+        // wait for the first interrupt, so we start measuring at the start of an interval
+        bool ok = awaitWatchdog(rt->counts(), timeout);
+        const uint32_t start = rt->counts();
+        ok = ok && awaitWatchdog(start, timeout);
+        const uint32_t end = rt->counts();
+        setWatchdogInterrupts(-1); // off
+
+        if (ok) {
+            const uint32_t period = (end - start) * nominalWatchdogPeriod / nominal;
+            // reject anything that can't be a real watchdog interval, e.g. due to a stalled real timer
+            if (period >= nominalWatchdogPeriod / 2 && period <= nominalWatchdogPeriod * 3 / 2) {
+                watchdogPeriod = period;
+                log::debug(F("WDT: "), dec(watchdogPeriod));
+                return true;
+            }
+        }
+        log::debug(F("WDT calibration failed"));
+        return false;
+    }
+
+    /**
+     * Returns the measured length of the shortest (nominally 16ms) watchdog interval, in 1/16 ms.
+     */
+    uint16_t getWatchdogPeriod() const {
+        return watchdogPeriod;
+    }
+
+    /**
+     * Informs the power manager of the current supply voltage in mV, e.g. as measured by Passive::SupplyVoltage.
+     * Since the watchdog frequency depends on the supply voltage, this will schedule a re-calibration before
+     * the next sleep when the voltage has changed significantly since the last calibration.
+     */
+    void onSupplyVoltage(uint16_t mV) {
+        const uint16_t delta = (mV > calibrationVoltage) ? mV - calibrationVoltage : calibrationVoltage - mV;
+        if (delta > recalibrationVoltageDelta) {
+            calibrationVoltage = mV;
+            sleptSinceCalibration = recalibrationInterval;
+        }
+    }
+
     /**
      * Attempts to sleep (power down) for at most until the given Deadline or Periodic timer fires.
      * A hardware or pin change interrupt can cause premature wake-up.
@@ -184,7 +395,7 @@ public:
     	if (task.isIdle()) {
     		return sleepUntilTasks();
     	} else {
-    		return sleepFor(task.timeLeft(), task.getMaxSleepMode(), SleepGranularity::_8000ms);
+    		return sleepFor(task.latestWakeup(), task.getMaxSleepMode(), SleepGranularity::_8000ms);
     	}
     }
 
@@ -198,28 +409,34 @@ public:
     		} else {
     			// both tasks are non-idle, let's compare them.
     	    	auto mode = (task1.getMaxSleepMode() > task2.getMaxSleepMode()) ? task2.getMaxSleepMode() : task1.getMaxSleepMode();
-    	    	Milliseconds time1 = task1.timeLeft();
-    	    	Milliseconds time2 = task2.timeLeft();
+    	    	Milliseconds time1 = task1.latestWakeup();
+    	    	Milliseconds time2 = task2.latestWakeup();
     	    	auto time = (time1 > time2) ? time2 : time1;
     	    	return sleepUntilTasks(TaskState::busy(time, mode), tail...);
     		}
     	}
     }
 
+    /**
+     * Sleeps until the latest time that still satisfies all of the given tasks, i.e. the earliest
+     * timeLeft() + getSlack() of all tasks. Tasks that have declared slack can thereby have their deadlines
+     * combined with those of other tasks into a single wake-up. Idle tasks are ignored.
+     */
     bool sleepUntilTasks(TaskState *states, uint8_t N) {
-        if (N == 0) {
-            return false;
-        //} else if (N == 1) {
-        //    return sleepFor(states->timeLeft(), states->getMaxSleepMode(), SleepGranularity::_8000ms);
-        } else {
-            SleepMode mode = states[0].getMaxSleepMode();
-            Milliseconds time = states[0].timeLeft();
-            for (uint8_t i = 1; i < N; i++) {
+        SleepMode mode = SleepMode::POWER_DOWN;
+        Milliseconds time = 0xFFFFFFFF;
+        bool busy = false;
+        for (uint8_t i = 0; i < N; i++) {
+            if (!states[i].isIdle()) {
+                busy = true;
                 mode = (mode > states[i].getMaxSleepMode()) ? states[i].getMaxSleepMode() : mode;
-                time = (time > states[i].timeLeft()) ? states[i].timeLeft() : time;
+                time = (time > states[i].latestWakeup()) ? states[i].latestWakeup() : time;
             }
-            return sleepFor(time, mode, SleepGranularity::_8000ms);
         }
+        if (!busy) {
+            return sleepUntilTasks();
+        }
+        return sleepFor(time, mode, SleepGranularity::_8000ms);
     }
 
     /**
@@ -254,9 +471,13 @@ public:
 };
 }
 
-template <typename rt_t>
-Impl::Power<rt_t> Power(rt_t &rt) {
-    return Impl::Power<rt_t>(rt);
+/**
+ * Creates a power manager for the given real timer, e.g. Power(rt), or Power<decltype(rt), true>(rt) to sleep
+ * tickless in IDLE mode.
+ */
+template <typename rt_t, bool tickless = false>
+Impl::Power<rt_t, tickless> Power(rt_t &rt) {
+    return Impl::Power<rt_t, tickless>(rt);
 }
 
 }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include "Time/RealTimer.hpp"
+#include "Tasks/TaskState.hpp"
+#include "Logging.hpp"
+
+namespace HAL {
+namespace Atmel {
+
+namespace Impl {
+
+/** Value written to all free RAM at startup, so bytes that the stack has never reached can be recognized. */
+constexpr uint8_t stackCanary = 0xC5;
+
+/** Fills [begin, end) with the canary */
+__attribute__((always_inline)) inline void paintStack(uint8_t *begin, uint8_t *end) {
+    for (uint8_t *p = begin; p < end; p++) {
+        *p = stackCanary;
+    }
+}
+
+/**
+ * Returns the number of bytes, counting up from [begin], that still hold the canary. Since the stack grows
+ * downwards from [end], this is the least free memory there has been since painting.
+ */
+inline uint16_t countPainted(const uint8_t *begin, const uint8_t *end) {
+    const uint8_t *p = begin;
+    while (p < end && *p == stackCanary) {
+        p++;
+    }
+    return p - begin;
+}
+
+#ifndef AVR
+/** Memory region that stackHighWater() inspects on the host, to be painted by tests. */
+struct SimulatedStack {
+    uint8_t *begin;
+    uint8_t *end;
+};
+
+extern SimulatedStack simulatedStack;
+#endif
+
+}
+
+/**
+ * Returns the least number of free bytes there have been between the end of static data (__heap_start) and the
+ * stack, since startup. On AVR, all of that region is painted with a canary in .init3, before any constructors
+ * run, as soon as this function is linked in. A low value means the application is about to overwrite its
+ * fifos and fields with stack frames, and crash.
+ */
+uint16_t stackHighWater();
+
+/**
+ * Task that periodically logs stackHighWater() through Loggers::Stack, e.g.
+ *
+ *     auto stack = stackMonitor(rt, 60_s);
+ *     ...
+ *     loopTasks(power, stack, ...);
+ */
+template <typename rt_t, typename value_t>
+class StackMonitor {
+    typedef Logging::Log<Loggers::Stack> log;
+
+    Periodic<rt_t, value_t> every;
+    uint16_t lowest = 0xFFFF;
+
+public:
+    /** Only needs its loop() invoked when the periodic has elapsed */
+    typedef InterruptHandlers::NoHandlers<StackMonitor<rt_t, value_t>> WakeOn;
+
+    StackMonitor(rt_t &rt): every(rt) {}
+
+    /** Returns the free bytes as of the most recent report, or 0xFFFF if there hasn't been one yet. */
+    uint16_t getLowest() const {
+        return lowest;
+    }
+
+    TaskState getTaskState() const {
+        return TaskState(every.timeLeftIfScheduled(), SleepMode::POWER_DOWN);
+    }
+
+    void loop() {
+        if (every.isNow()) {
+            lowest = stackHighWater();
+            log::debug(F("free "), Streams::dec(lowest));
+        }
+    }
+};
+
+template <typename rt_t, typename value_t>
+StackMonitor<rt_t, value_t> stackMonitor(rt_t &rt, value_t value) {
+    return StackMonitor<rt_t, value_t>(rt);
+}
+
+}
+}
@@ -16,11 +16,19 @@ using namespace HAL::Atmel::InterruptHandlers;
 using namespace HAL::Atmel::Registers;
 using namespace Streams;
 
+/**
+ * Whether a TWI transaction is in progress. There's only one TWI peripheral, so this is shared by all TWI
+ * instantiations, which lets sleep() find out whether it may stop the TWI clock.
+ */
+struct TWIBus {
+    static volatile bool transceiving;
+};
+
 /**
  * Hardware Atmel TWI support. Based off the arduino libraries.
  */
 template <typename info_t, uint8_t txFifoSize, uint8_t rxFifoSize, uint32_t twiFreq>
-class TWI {
+class TWI: public TWIBus {
 	static constexpr uint8_t TW_START = 0x08;
 	static constexpr uint8_t TW_REP_START = 0x10;
 	static constexpr uint8_t TW_MT_SLA_ACK	= 0x18;
@@ -55,7 +63,6 @@ public:
 
     volatile uint8_t ints = 0;
 
-    static volatile bool transceiving;
     static void startWriting() {
     	log::debug(F("go!"), '0' + transceiving, ' ', dec(TWCR));
         if (!transceiving) {
@@ -98,7 +105,7 @@ public:
 
     void onTWI() {
     	ints++;
-    	//log::debug('t',':',dec(TW_STATUS));
+    	Logging::event<log>(Logging::Event::TWI_STATUS, TW_STATUS());
         switch(TW_STATUS()) {
         // All Master
     case TW_START:     // sent start condition
@@ -290,6 +297,8 @@ public:
         info_t::PinSCL::DDR.clear();
         info_t::PinSCL::PORT.clear();
 
+        PRTWI.clear(); // start the TWI clock, in case it was powered down
+
         // initialize twi prescaler and bit rate
         TWPS0.clear();
         TWPS1.clear();
@@ -392,9 +401,6 @@ public:
     }
 };
 
-template <typename info_t, uint8_t txFifoSize, uint8_t rxFifoSize, uint32_t twiFreq>
-volatile bool TWI<info_t,txFifoSize,rxFifoSize,twiFreq>::transceiving = false;
-
 }
 }
 }
@@ -24,6 +24,7 @@ public:
     typedef info usart_info_t;
 
     Usart(uint32_t baud = 57600) {
+        info::PRUSART.clear(); // start the USART clock, in case it was powered down
         uint16_t baud_setting = (F_CPU / 4 / baud - 1) / 2;
         if (baud_setting > 4095) {
             baud_setting = (F_CPU / 8 / baud - 1) / 2;
@@ -4,6 +4,7 @@
 #include <HAL/Atmel/Registers.hpp>
 #include "Time/Prescaled.hpp"
 #include "HAL/Atmel/InterruptHandlers.hpp"
+#include "HAL/Atmel/InterruptTrace.hpp"
 #include "HAL/Atmel/Usart.hpp"
 #include "HAL/Atmel/Pin.hpp"
 #include "HAL/Atmel/TWI.hpp"
@@ -81,6 +82,7 @@ struct Usart0Info {
 	static constexpr auto UCSZ1 = UCSZ01;
 	static constexpr auto TXC = TXC0;
 	static constexpr auto UDR = UDR0;
+	static constexpr auto PRUSART = PRUSART0;
 };
 
 } // namespace Info
@@ -181,13 +183,20 @@ struct Timer0Info {
     	}
     }
 
+    /** Returns whether the timer is currently counting off the system clock. */
+    static bool isRunning() {
+        return CS00.isSet() || CS01.isSet() || CS02.isSet();
+    }
+
     static void configureNormal(prescaler_t p) {
+        PRTIM0.clear();
         WGM00.clear(); // Mode 0, normal
         WGM01.clear();
         setPrescaler(p);
     }
 
     static void configureFastPWM(prescaler_t p) {
+        PRTIM0.clear();
         WGM00.set(); // Mode 3, count up to 0xFF
         WGM01.set();
         setPrescaler(p);
@@ -239,7 +248,13 @@ struct Timer1Info {
     	}
     }
 
+    /** Returns whether the timer is currently counting off the system clock. */
+    static bool isRunning() {
+        return CS10.isSet() || CS11.isSet() || CS12.isSet();
+    }
+
     static void configureNormal(prescaler_t p) {
+        PRTIM1.clear();
         WGM10.clear();
         WGM11.clear();
         WGM12.clear();
@@ -248,6 +263,7 @@ struct Timer1Info {
     }
 
     inline static void configureFastPWM(prescaler_t p) {
+        PRTIM1.clear();
         WGM10.clear();
         WGM11.set();
         WGM12.set();
@@ -279,6 +295,18 @@ struct Timer1Info {
         static constexpr auto COM1 = COM1B1;
         static constexpr auto FOC = FOC1B;
     };
+
+    /** Latches TCNT1 into ICR1 on an edge of the ICP1 pin (PB0, Arduino pin D8). Not available in fast PWM mode. */
+    struct InputCapture {
+        typedef Int_TIMER1_CAPT_ INT;
+        static constexpr auto ICR = ICR1;
+        static constexpr auto ICES = ICES1;
+        static constexpr auto ICIE = ICIE1;
+        static constexpr auto ICF = ICF1;
+        static constexpr auto PIN = PINB0;
+        static constexpr auto DDR = DDB0;
+        static constexpr auto PORT = PORTB0;
+    };
 };
 
 struct Timer1LoInfo: public Timer1Info {
@@ -323,13 +351,20 @@ struct Timer2Info {
     	}
     }
 
+    /** Returns whether the timer is currently counting off the system clock. */
+    static bool isRunning() {
+        return AS2.isCleared() && (CS20.isSet() || CS21.isSet() || CS22.isSet());
+    }
+
     static void configureNormal(prescaler_t p) {
+        PRTIM2.clear();
         WGM20.clear();
         WGM21.clear();
         setPrescaler(p);
     }
 
     static void configureFastPWM(prescaler_t p) {
+        PRTIM2.clear();
         WGM20.set();
         WGM21.set();
         setPrescaler(p);
@@ -769,6 +804,47 @@ struct TWIInfo {
 template <uint8_t txFifoSize = 32, uint8_t rxFifoSize = 32, uint32_t twiFreq = 100000l>
 using TWI = Impl::TWI<TWIInfo, txFifoSize, rxFifoSize, twiFreq>;
 
+/**
+ * Stops the clock (through PRR) of every peripheral that the application doesn't use. A peripheral is considered
+ * in use if [handlers_t] binds to any of its interrupt vectors, or if it has already been enabled by a driver, e.g.
+ * SPI by SPIMaster, or a timer by configuring its prescaler. Drivers that enable a peripheral later on will
+ * start its clock again.
+ *
+ * This is invoked by RUN_APP, with the application's Handlers, after all of its fields have been initialized.
+ */
+template <typename handlers_t>
+void gateUnusedPeripherals() {
+    typedef handlers_t h;
+
+    if (!h::template Handles<Int_ADC_>::value && ADEN.isCleared()) {
+        PRADC.set();
+    }
+    if (!h::template Handles<Int_USART_RX_>::value && !h::template Handles<Int_USART_UDRE_>::value &&
+            RXEN0.isCleared() && TXEN0.isCleared()) {
+        PRUSART0.set();
+    }
+    if (SPE.isCleared()) {
+        PRSPI.set();
+    }
+    if (!h::template Handles<Int_TWI_>::value && TWEN.isCleared()) {
+        PRTWI.set();
+    }
+    if (!h::template Handles<Int_TIMER0_OVF_>::value && !h::template Handles<Int_TIMER0_COMPA_>::value &&
+            !h::template Handles<Int_TIMER0_COMPB_>::value && !Info::Timer0Info::isRunning()) {
+        PRTIM0.set();
+    }
+    if (!h::template Handles<Int_TIMER1_OVF_>::value && !h::template Handles<Int_TIMER1_COMPA_>::value &&
+            !h::template Handles<Int_TIMER1_COMPB_>::value && !h::template Handles<Int_TIMER1_CAPT_>::value &&
+            !Info::Timer1Info::isRunning()) {
+        PRTIM1.set();
+    }
+    // Timer 2 keeps running from an external crystal in asynchronous mode.
+    if (!h::template Handles<Int_TIMER2_OVF_>::value && !h::template Handles<Int_TIMER2_COMPA_>::value &&
+            !h::template Handles<Int_TIMER2_COMPB_>::value && !Info::Timer2Info::isRunning() && AS2.isCleared()) {
+        PRTIM2.set();
+    }
+}
+
 
 } // namespace Atmel
 } // namespace HAL
@@ -786,6 +862,7 @@ using TWI = Impl::TWI<TWIInfo, txFifoSize, rxFifoSize, twiFreq>;
     mkISR(TIMER2_COMPA, 7) \
     mkISR(TIMER2_COMPB, 8) \
     mkISR(TIMER2_OVF, 9) \
+    mkISR(TIMER1_CAPT, 10) \
     mkISR(TIMER1_COMPA, 11) \
     mkISR(TIMER1_COMPB, 12) \
     mkISR(TIMER1_OVF, 13) \
@@ -798,7 +875,6 @@ using TWI = Impl::TWI<TWIInfo, txFifoSize, rxFifoSize, twiFreq>;
     mkISR(TWI, 24) \
 
 /*
-//    mkISR(TIMER1_CAPT, 10) \
 //    mkISR(SPI_STC, 17) \
 //    mkISR(USART_TX, 20) \
 //mkISR(EE_READY, 22) \
@@ -18,7 +18,7 @@ public:
 #ifdef AVR
     static INLINE This &reg() { return *((This*) addr); }
 #else
-    static INLINE This &reg() { return *((This*) sfr_mem + addr); }
+    static INLINE This &reg() { return *((This*) (sfr_mem + addr)); }
 #endif
     static constexpr uintptr_t address = addr;
 
@@ -32,7 +32,11 @@ template <typename Reg>
 class StaticRegister16 {
 public:
     static INLINE Reg &reg() { return Reg::reg(); }
+#ifdef AVR
   INLINE static uint16_t get() { return *((volatile uint16_t *) Reg::address); }
+#else
+  INLINE static uint16_t get() { return reg().get(); }
+#endif
     INLINE static void set(uint16_t v) { reg().set(v); }
   INLINE static uint16_t &val() { return reg().val(); }
 };
@@ -16,6 +16,11 @@ public:
         PREAMBLE1, PREAMBLE2, PREAMBLE3, SYNC1, SYNC2, HEADER, LENGTH, DATA, CRCLSB, CRCMSB, POSTFIX, DONE
     };
 
+    /** Every chunk starts with its packet type, so FSK and OOK packets can be queued in the same fifo. */
+    enum PacketType: uint8_t {
+        FSK_PACKET, OOK_PACKET
+    };
+
     Fifo<fifoSize> data;
     ChunkedFifoCB<callback_t, target_t> fifo;
     CRC16 crc;
@@ -29,28 +34,35 @@ public:
         return fifo;
     }
 
-    template <typename T>
-    bool write_ook(SerialConfig *type, T *packet) {
-        auto type_ptr = (uintptr_t) type;
-        return fifo.write(type_ptr, packet);
+    /** Queues a placeholder for an OOK packet whose pulses are rendered elsewhere, keeping it in order with FSK. */
+    bool write_ook() {
+        return fifo.write(uint8_t(OOK_PACKET));
+    }
+
+    /** Returns whether write_ook() will succeed, i.e. there's room for the length and the packet type. */
+    bool hasSpaceForOOK() const {
+        return fifo.getSpace() >= 2;
     }
 
     template <typename... types>
     bool write_fsk(uint8_t header, types...args) {
-        return fifo.write(uintptr_t(0), header, args...);
+        return fifo.write(uint8_t(FSK_PACKET), header, args...);
     }
 
-    /** Returns whether or not this indeed is an FSK packet, i.e. SerialConfig was nullptr calling out(). */
+    /**
+     * Returns whether or not this indeed is an FSK packet, i.e. it was queued by write_fsk(). An OOK packet is
+     * taken out of the fifo, since its pulses are to be sent from where it was rendered.
+     */
     bool readStart() {
         fifo.readStart();
-        SerialConfig *type;
-        if (fifo.read((uintptr_t*) (&type))) {
-            if (type == nullptr) {
+        uint8_t type;
+        if (fifo.read(&type)) {
+            if (type == FSK_PACKET) {
                 crc.reset();
                 packetIndex = PacketIndex::PREAMBLE1;
                 return true;
             } else {
-                fifo.readAbort();
+                fifo.readEnd();
                 return false;
             }
         } else {
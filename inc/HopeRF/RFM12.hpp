@@ -21,7 +21,7 @@
 #include "HopeRF/RFM12Status.hpp"
 #include "HopeRF/RFM12Strength.hpp"
 #include "FS20/FS20Packet.hpp"
-#include "Serial/SerialTx.hpp"
+#include "Serial/RenderedPulseSource.hpp"
 #include "Time/Units.hpp"
 #include "Tasks/TaskState.hpp"
 
@@ -41,6 +41,7 @@ struct Headers {
     static constexpr uint8_t RXSTATE = 2; // State from spark to node
     static constexpr uint8_t TXSTATE = 3; // State from node to spark
     static constexpr uint8_t REQ = 4;     // Request re-send of latest state
+    static constexpr uint8_t METRICS = 6; // Runtime metrics from node to spark, see MetricsReporter
     static constexpr uint8_t APP = 42;
 };
 
@@ -155,6 +156,7 @@ private:
         uint8_t in = 0;
         // The RFM12 will keep the INT line low until we read the status register.
         auto status = getStatus(in);
+        Logging::event<log>(Logging::Event::RFM12_STATUS, status.underlying());
         if (status[RFM12Status::READY_FOR_NEXT_BYTE]) {
             if (mode == Mode::SENDING_OOK) {
                 // there shouldn't be any interrupts from RFM12 during OOK sending
@@ -198,6 +200,7 @@ private:
         // fifo overflow or buffer underrun - abort reception/sending
         if (status[RFM12Status::UNDERRUN_OVERFLOW]) {
             underruns++;
+            Logging::event<log>(Logging::Event::RFM12_UNDERRUN, underruns);
             rxFifo.writeAbort();
             txFifo.readAbort();
             idle();
@@ -291,14 +294,17 @@ private:
     };
 
     friend struct OOKSource;
-    struct OOKSource: public ChunkPulseSource {
+    typedef StaticSerialConfig<FS20::FS20Packet::SerialFormat<comparator_t>> fs20SerialConfig_t;
+    typedef StaticChunkPulseSource<fs20SerialConfig_t> fs20Source_t;
+
+    struct OOKSource: public fs20Source_t {
         This *rfm12;
 
-        OOKSource(This *_rfm12, AbstractChunkedFifo &_fifo): ChunkPulseSource(_fifo), rfm12(_rfm12) {}
+        OOKSource(This *_rfm12, AbstractChunkedFifo &_fifo): fs20Source_t(_fifo), rfm12(_rfm12) {}
 
         Pulse getNextPulse() {
             rfm12->pulses++;
-            Pulse result = ChunkPulseSource::getNextPulse();
+            Pulse result = fs20Source_t::getNextPulse();
             if (!result.isEmpty()) {
                 // because of SPI delays, and the DELAY and TRANSMITTER_ON messages being processed by the RFM12
                 // at different delays, we need to make an adjustment between the desired pulse lengths, and the actual
@@ -314,11 +320,17 @@ private:
         }
     };
 
+    // FS20 packets are rendered into pulses by write_fs20(), so the comparator interrupt only has to pop them.
+    // Two of them fit, so the next packet can be rendered while the previous one is being sent.
+    typedef RenderedPulseSource<OOKSource, 160, 8, 2> ookPulses_t;
+
     OOKTarget ookTarget = { this };
-    OOKSource ookSource = { this, txFifo.getChunkedFifo() };
-    typedef PulseTx<comparator_t, OOKTarget, OOKSource> ookTx_t;
-    ookTx_t ookTx = ookTx_t(*comparator, ookTarget, ookSource);
-    SerialConfig fs20SerialConfig = FS20::FS20Packet::serialConfig<comparator_t>();
+    Fifo<8> fs20Data = {};
+    ChunkedFifo fs20Fifo = { fs20Data };
+    OOKSource ookSource = { this, fs20Fifo };
+    ookPulses_t ookPulses = { ookSource };
+    typedef PulseTx<comparator_t, OOKTarget, ookPulses_t> ookTx_t;
+    ookTx_t ookTx = ookTx_t(*comparator, ookTarget, ookPulses);
 
 public:
     typedef
@@ -417,9 +429,17 @@ public:
         return txFifo.write_fsk(header, args...);
     }
 
+    /**
+     * Renders the packet's pulses right away, and queues its turn to be sent. Returns false if the packet wasn't
+     * queued, e.g. because two FS20 packets are still waiting to be sent.
+     */
     bool write_fs20(const FS20::FS20Packet &packet) {
         log::debug(F("queueing FS20"));
-        return txFifo.write_ook(&fs20SerialConfig, &packet);
+        if (!ookPulses.hasSpace() || !txFifo.hasSpaceForOOK()) {
+            return false;
+        }
+        fs20Fifo.write(&packet);
+        return ookPulses.renderChunk() && txFifo.write_ook();
     }
 };
 
@@ -435,4 +455,16 @@ RFM12<spi_t, ss_pin_t, int_pin_t, comparator_t, checkCrc, rxFifoSize, txFifoSize
 
 }
 
+namespace HAL {
+namespace Atmel {
+namespace InterruptHandlers {
+
+/** Tasks can wake on the RFM12's interrupt, e.g. TxState::WakeOn. */
+template <typename spi_t, typename ss_pin_t, typename int_pin_t, typename comparator_t, bool checkCrc, int rxFifoSize, int txFifoSize>
+struct WakesTasks<HopeRF::RFM12<spi_t, ss_pin_t, int_pin_t, comparator_t, checkCrc, rxFifoSize, txFifoSize>>: public std::true_type {};
+
+}
+}
+}
+
 #endif /* RFM12_HPP_ */
@@ -38,6 +38,9 @@ class TxState {
     }
 
 public:
+    /** Only needs its loop() invoked when the RFM12 has received something, or on resend. */
+    typedef typename rfm_t::Handlers WakeOn;
+
     TxState(rfm_t &r, rt_t &t, T initial, uint16_t _nodeId):
         rfm(&r), rt(&t), nodeId(_nodeId),
         resendOffset(((_nodeId) ^ (_nodeId >> 4) ^ (_nodeId >> 8) ^ (_nodeId >> 12)) & 0x000F),
@@ -75,7 +78,7 @@ public:
 
   TaskState getTaskState() {
     // Let's try IDLE to make sure we count the resend delay properly.
-    return TaskState(resend.timeLeft().template toMillisOn<rt_t>(), SleepMode::IDLE);
+    return TaskState(resend.timeLeftIfScheduled(), SleepMode::IDLE);
   }
 };
 
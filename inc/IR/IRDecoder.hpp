@@ -1,7 +1,7 @@
 #ifndef IRDECODER_H
 #define IRDECODER_H
 
-#include "Serial/PulseCounter.hpp"
+#include "Serial/OOKDecoder.hpp"
 #include "Streams/Protocol.hpp"
 #include "Enum.hpp"
 
@@ -54,224 +54,62 @@ public:
 
 };
 
-template <typename pulsecounter_t>
-class IRUtils {
-public:
-    typedef typename pulsecounter_t::Timer Timer;
-
-    static bool isMatch(const Pulse &pulse, const bool high, const uint16_t minLength, const uint16_t maxLength) {
-        return pulse.isHigh() == high &&
-               pulse.getDuration() >= minLength &&
-               pulse.getDuration() <= maxLength;
-    }
-
-    template <typename Value>
-    static constexpr uint16_t min() {
-    	return toCountsOn<Timer>(60_percentOf(Value::instance)).getValue();
-    }
-
-    template <typename Value>
-    static constexpr uint16_t max() {
-    	return toCountsOn<Timer>(125_percentOf(Value::instance)).getValue();
-    }
-
-    template <typename Value>
-    static inline bool isHigh(const Pulse &event, Value value) {
-        return isMatch(event, false, min<Value>(), max<Value>());
-    }
-
-    template <typename Value>
-    static inline bool isLow(const Pulse &event, Value value) {
-        return isMatch(event, true,  min<Value>(), max<Value>());
-    }
-
-    void reset() {
-    }
-};
-
-template <typename pulsecounter_t, uint8_t fifoSize = 32>
-class IRDecoder_NEC: public IRUtils<pulsecounter_t> {
-    typedef typename pulsecounter_t::Timer Timer;
-public:
-    enum class State: uint8_t { Receiving, Repeat };
-
-    State state = State::Receiving;
-    uint8_t count = -1;
-    uint32_t command = 0;
-    Fifo<fifoSize> fifo;
-
-    void reset() {
-        count = -1;
-        command = 0;
-        state = State::Receiving;
-    }
-
-    void decoded(IRType type) {
-        auto code = IRCode(type, command);
-        fifo.write(&code);
-        reset();
-    }
-
-    void onReceiving(const Pulse &event) {
-        count++;
-
-        if (count == 0) {
-            if (event.isDefined() && event.isHigh()) {
-                return;
-            } else {
-                count = -1;
-                return;
-            }
-        }
-        if (count == 1) {
-            if (!this->isHigh(event, 9000_us)) {
-                reset();
-                return;
-            }
-        }
-        if (count == 2) {
-            if (this->isLow(event, 2250_us)) {
-                state = State::Repeat;
-                return;
-            } else if (!this->isLow(event, 4500_us)) {
-                reset();
-                return;
-            }
-        }
-        if (count >= 3) {
-            if (count % 2 == 0) {
-                if (this->isLow(event, 1690_us)) {
-                    command = (command << 1) | 1;
-                } else if (this->isLow(event, 560_us)) {
-                    command <<= 1;
-                } else {
-                    reset();
-                    return;
-                }
-            } else {
-                if (!this->isHigh(event, 560_us)) {
-                    reset();
-                    return;
-                }
-            }
-        }
-        if (count >= 2 * 32 + 3) {
-            decoded(IRType::Command);
-        }
-    }
-
-    void onRepeat(const Pulse &event) {
-        if (this->isHigh(event, 560_us)) {
-            decoded(IRType::Repeat);
+namespace Impl {
+
+/**
+ * The NEC IR protocol, and variants of it with different header and one-bit timings. Pulses are inverted, as
+ * IR receivers output low during a mark. After the header, 32 bits are sent MSB first, without parity. A repeat
+ * code is a header with a shorter space, and a single mark.
+ */
+template <typename headerMark_t, typename headerSpace_t, typename oneSpace_t>
+struct NECFormat {
+    typedef IRCode packet_t;
+
+    template <typename prescaled_t, typename duration_t>
+    static constexpr PulseSpec spec(bool high, duration_t duration) {
+        return PulseSpec {
+            high,
+            uint16_t(toCountsOn<prescaled_t>(60_percentOf(duration)).getValue()),
+            uint16_t(toCountsOn<prescaled_t>(125_percentOf(duration)).getValue()) };
+    }
+
+    template <typename prescaled_t>
+    static constexpr OOKProtocol protocol() {
+        return OOKProtocol {
+            { spec<prescaled_t>(false, headerMark_t::instance), spec<prescaled_t>(true, headerSpace_t::instance) }, 2,
+            { spec<prescaled_t>(false, headerMark_t::instance), spec<prescaled_t>(true, 2250_us), spec<prescaled_t>(false, 560_us) }, 3,
+            /* syncBits */ 0,
+            { spec<prescaled_t>(false, 560_us), spec<prescaled_t>(true, 560_us) },
+            { spec<prescaled_t>(false, 560_us), spec<prescaled_t>(true, oneSpace_t::instance) },
+            SerialBitOrder::MSB_FIRST,
+            SerialParity::NONE,
+            &packetBytes,
+            nullptr };
+    }
+
+    static uint8_t packetBytes(const uint8_t *data, uint8_t bytes) {
+        return 4;
+    }
+
+    static IRCode toPacket(const uint8_t *data, uint8_t bytes) {
+        if (bytes == 0) {
+            return IRCode(IRType::Repeat, 0);
         } else {
-            reset();
+            return IRCode(IRType::Command, (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint16_t(data[2]) << 8) | data[3]);
         }
     }
-
-public:
-    void apply(const Pulse &event) {
-        switch(state) {
-          case State::Receiving: onReceiving(event); break;
-          case State::Repeat: onRepeat(event); break;
-        }
-    }
-
-    Streams::ReadResult read(IRCode *code) {
-        return fifo.read(code);
-    }
 };
 
+}
 
-template <typename pulsecounter_t, uint8_t fifoSize = 32>
-class IRDecoder_Samsung: public IRUtils<pulsecounter_t> {
-    typedef typename pulsecounter_t::Timer Timer;
-public:
-    enum class State: uint8_t { Receiving, Repeat };
-
-    State state = State::Receiving;
-    uint8_t count = -1;
-    uint32_t command = 0;
-    Fifo<fifoSize> fifo;
-
-    void reset() {
-        count = -1;
-        command = 0;
-        state = State::Receiving;
-    }
-
-    void decoded(IRType type) {
-        auto code = IRCode(type, command);
-        fifo.write(&code);
-        reset();
-    }
-
-    void onReceiving(const Pulse &event) {
-        count++;
-        if (count == 0) {
-            if (event.isDefined() && event.isHigh()) {
-                return;
-            } else {
-                count = -1;
-                return;
-            }
-        }
-        if (count == 1) {
-            if (!this->isHigh(event, 5000_us)) {
-                reset();
-                return;
-            }
-        }
-        if (count == 2) {
-            if (this->isLow(event, 2250_us)) {
-                state = State::Repeat;
-                return;
-            } else if (!this->isLow(event, 5000_us)) {
-                reset();
-                return;
-            }
-        }
-        if (count >= 3) {
-            if (count % 2 == 0) {
-                if (this->isLow(event, 1600_us)) {
-                    command = (command << 1) | 1;
-                } else if (this->isLow(event, 560_us)) {
-                    command <<= 1;
-                } else {
-                    reset();
-                    return;
-                }
-            } else {
-                if (!this->isHigh(event, 560_us)) {
-                    reset();
-                    return;
-                }
-            }
-        }
-        if (count >= 2 * 32 + 3) {
-            decoded(IRType::Command);
-        }
-    }
-
-    void onRepeat(const Pulse &event) {
-        if (this->isHigh(event, 560_us)) {
-            decoded(IRType::Repeat);
-        } else {
-            reset();
-        }
-    }
+typedef Impl::NECFormat<decltype(9000_us), decltype(4500_us), decltype(1690_us)> NECFormat;
+typedef Impl::NECFormat<decltype(5000_us), decltype(5000_us), decltype(1600_us)> SamsungFormat;
 
-public:
-    void apply(const Pulse &event) {
-        switch(state) {
-          case State::Receiving: onReceiving(event); break;
-          case State::Repeat: onRepeat(event); break;
-        }
-    }
+template <typename pulsecounter_t, uint8_t fifoSize = 32>
+using IRDecoder_NEC = OOKDecoder<typename pulsecounter_t::Timer, NECFormat, fifoSize>;
 
-    Streams::ReadResult read(IRCode *code) {
-        return fifo.read(code);
-    }
-};
+template <typename pulsecounter_t, uint8_t fifoSize = 32>
+using IRDecoder_Samsung = OOKDecoder<typename pulsecounter_t::Timer, SamsungFormat, fifoSize>;
 
 }
 
@@ -7,28 +7,40 @@ struct Log;
 
 }
 
+/**
+ * All loggers must be listed here. Each is declared as an empty class in namespace Loggers, and has its timing probe printed by
+ * printProbes() if timing is enabled for it.
+ */
+#define LOGGING_FOR_EACH_LOGGER(X) \
+    X(VisonicDecoder) \
+    X(Streams) \
+    X(Scanner) \
+    X(Serial) \
+    X(RS232Tx) \
+    X(RFM12) \
+    X(ESP8266) \
+    X(DHT11) \
+    X(Timing) \
+    X(Dallas) \
+    X(Main) \
+    X(Passive) \
+    X(TWI) \
+    X(PIR) \
+    X(PinChangeInterrupt) \
+    X(Power) \
+    X(RxState) \
+    X(TxState) \
+    X(FrequencyCounter) \
+    X(Ambient) \
+    X(Tasks) \
+    X(Events) \
+    X(Interrupts) \
+    X(Stack)
+
 namespace Loggers {
-// All loggers must be listed here as empty classes
-class VisonicDecoder;
-class Streams;
-class Scanner;
-class Serial;
-class RS232Tx;
-class RFM12;
-class ESP8266;
-class DHT11;
-class Timing;
-class Dallas;
-class Main;
-class Passive;
-class TWI;
-class PIR;
-class PinChangeInterrupt;
-class Power;
-class RxState;
-class TxState;
-class FrequencyCounter;
-class Ambient;
+#define LOGGING_DECLARE_LOGGER(name) class name;
+LOGGING_FOR_EACH_LOGGER(LOGGING_DECLARE_LOGGER)
+#undef LOGGING_DECLARE_LOGGER
 }
 
 
@@ -38,19 +50,14 @@ class Ambient;
 #include "AtomicScope.hpp"
 #include <HAL/Atmel/Registers.hpp>
 
+#include "gcc_type_traits.h"
+
 #ifndef AVR
 #include <stdarg.h>
 #include <stdio.h>
 #include <mutex>
 #endif
 
-constexpr uint8_t debugTimingMax = 32;
-
-extern volatile uint16_t debugTimings[debugTimingMax];
-extern volatile uint8_t debugTimingsCount;
-
-static uint16_t debugStartTime;
-
 namespace Logging {
 
 using namespace HAL::Atmel::Registers;
@@ -61,30 +68,212 @@ extern std::mutex logging_mutex;
 }
 #endif
 
+/** Statistics of the TCNT1 counts between timeStart() and timeEnd() of one timing probe */
+struct ProbeStats {
+    static constexpr uint8_t buckets = 17;
+
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    /**
+     * Number of samples by their number of significant bits, i.e. histogram[0] counts samples of 0,
+     * histogram[1] of 1, histogram[2] of 2..3, histogram[3] of 4..7, up to histogram[16] of 32768..65535.
+     */
+    uint16_t histogram[buckets];
+
+    __attribute__((always_inline)) inline void add(uint16_t duration) {
+        // Stop once saturated, so neither sum nor any histogram bucket can overflow.
+        if (count == 0xFFFF) {
+            return;
+        }
+        if (count == 0 || duration < min) {
+            min = duration;
+        }
+        if (duration > max) {
+            max = duration;
+        }
+        count++;
+        sum += duration;
+        uint8_t bucket = 0;
+        uint8_t d = duration;
+        if (duration >= 256) {
+            bucket = 8;
+            d = duration >> 8;
+        }
+        while (d != 0) {
+            bucket++;
+            d >>= 1;
+        }
+        histogram[bucket]++;
+    }
+
+    uint16_t mean() const {
+        return (count == 0) ? 0 : sum / count;
+    }
+};
+
+namespace Impl {
+
+template <uint8_t length>
+void printProbe(StringInProgmem<length> *name, const ProbeStats &stats);
+
+}
+
 struct TimingDisabled {
     static constexpr bool isTimingEnabled() { return false; }
     inline static void timeStart() {}
     inline static void timeEnd() {}
 };
 
-// The overhead of enabling timing is 34 cycles per sample.
+/**
+ * Collects statistics on the TCNT1 counts between timeStart() and timeEnd() of a logger, under the given probe name,
+ * to be printed by printProbes(). Timer 1 must be running (with prescaler 1 to measure cycles), and individual samples
+ * are limited to 65535 counts. A sample takes about 60 cycles.
+ */
+template <typename probeName>
 struct TimingEnabled {
     static constexpr bool isTimingEnabled() { return true; }
 
+    static uint16_t startTime;
+    static ProbeStats probe;
+
     __attribute__((always_inline)) inline static void timeStart() {
-        debugStartTime = TCNT1.get();
+        startTime = TCNT1.get();
     }
 
     __attribute__((always_inline)) inline static void timeEnd() {
-        uint16_t duration = TCNT1.get() - debugStartTime;
+        probe.add(TCNT1.get() - startTime);
+    }
+
+    static ProbeStats getProbe() {
+        AtomicScope _;
+        return probe;
+    }
+
+    static void printProbe() {
+        Impl::printProbe(probeName::instance(), getProbe());
+    }
 
-        if (debugTimingsCount < debugTimingMax) {
-            debugTimings[debugTimingsCount] = duration;
-            debugTimingsCount++;
+    static void clearProbe() {
+        AtomicScope _;
+        probe = {};
+    }
+};
+
+template <typename probeName>
+uint16_t TimingEnabled<probeName>::startTime;
+
+template <typename probeName>
+ProbeStats TimingEnabled<probeName>::probe;
+
+/**
+ * Makes Logging::event() record events for a logger, e.g.
+ *
+ *     template<> class Log<Loggers::RFM12>: public MessagesEnabled<STR("RFM12")>, public EventsEnabled {};
+ */
+struct EventsEnabled {
+    static constexpr bool isEventsEnabled() { return true; }
+};
+
+/** IDs of events that interrupt handlers record through Logging::event(), see printEvents(). */
+enum class Event: uint8_t {
+    /** arg: the RFM12 status word */
+    RFM12_STATUS,
+    /** arg: total number of RFM12 fifo underruns / overflows */
+    RFM12_UNDERRUN,
+    /** arg: the TWI status (TWSR & 0xF8) */
+    TWI_STATUS,
+    /** arg: the pin change bitmask in the high byte, PIN register value in the low byte */
+    PIN_CHANGE
+};
+
+namespace Impl {
+
+template <typename log_t>
+struct is_events_enabled {
+private:
+    template<typename U> static constexpr bool test(decltype(U::isEventsEnabled())) { return U::isEventsEnabled(); }
+    template<typename> static constexpr bool test(...) { return false; }
+public:
+    static constexpr bool value = test<log_t>(true);
+};
+
+/**
+ * Fixed-size ring of (event, uint16_t arg) records, written by interrupt handlers and read by the main loop.
+ * Only the writer changes writePos and only the reader changes readPos, so neither side needs to disable
+ * interrupts. Since AVR interrupt handlers don't nest, there can be several writers, as long as they're all
+ * interrupt handlers. Records that don't fit are counted as dropped.
+ */
+template <uint8_t size>
+class EventRing {
+    static_assert(size >= 2 && size <= 128 && (size & (size - 1)) == 0, "EventRing size must be a power of 2, up to 128");
+
+    volatile uint8_t ids[size];
+    volatile uint16_t args[size];
+    volatile uint8_t writePos = 0;
+    volatile uint8_t readPos = 0;
+    volatile uint8_t dropped = 0;
+
+public:
+    __attribute__((always_inline)) inline void write(uint8_t id, uint16_t arg) {
+        const uint8_t w = writePos;
+        const uint8_t next = (w + 1) & (size - 1);
+        if (next == readPos) {
+            if (dropped < 255) {
+                dropped++;
+            }
+        } else {
+            ids[w] = id;
+            args[w] = arg;
+            writePos = next;
         }
     }
+
+    bool read(uint8_t &id, uint16_t &arg) {
+        const uint8_t r = readPos;
+        if (r == writePos) {
+            return false;
+        }
+        id = ids[r];
+        arg = args[r];
+        readPos = (r + 1) & (size - 1);
+        return true;
+    }
+
+    /** Returns the number of records dropped since the previous invocation. */
+    uint8_t takeDropped() {
+        AtomicScope _;
+        const uint8_t result = dropped;
+        dropped = 0;
+        return result;
+    }
+
+    void clear() {
+        AtomicScope _;
+        readPos = writePos;
+        dropped = 0;
+    }
 };
 
+constexpr uint8_t eventRingSize = 16;
+
+extern EventRing<eventRingSize> events;
+
+}
+
+/**
+ * Records an event in the event ring, if events are enabled for the given logger (through EventsEnabled).
+ * Meant for interrupt handlers, where regular logging is too slow: it takes a few dozen cycles, and never blocks.
+ * The main loop should regularly call printEvents() to log the recorded events.
+ */
+template <typename log_t>
+__attribute__((always_inline)) inline void event(Event e, uint16_t arg) {
+    if (Impl::is_events_enabled<log_t>::value) {
+        Impl::events.write(uint8_t(e), arg);
+    }
+}
+
 template <typename... types>
 extern void onMessage(types... args);
 
@@ -114,6 +303,12 @@ struct MessagesDisabled {
 template <typename loggerName = STR("")>
 struct MessagesEnabled {
     static constexpr bool isDebugEnabled() { return true; }
+
+    /** Writes a log statement to [sink] as text, exactly as debug() would send it to onMessage() on AVR. */
+    template <typename sink_t, typename... types>
+    static bool writeTo(sink_t &sink, types... args) {
+        return sink.writeIfSpace(loggerName::instance(), F(": "), args..., crlf);
+    }
 #ifndef AVR
     template <typename... types>
     inline static void debug(types... args) {
@@ -141,6 +336,122 @@ struct MessagesEnabled {
 #endif
 };
 
+namespace Impl {
+
+#ifdef AVR
+/** On AVR, strings in binary log records are identified by their flash address. */
+inline uint16_t binaryId(const char *str) {
+    return uint16_t(str);
+}
+#else
+/** On the host, strings in binary log records are identified by their index (from 1) in binaryStrings(). */
+uint16_t binaryId(const char *str);
+
+const char *binaryString(uint16_t id);
+#endif
+
+/**
+ * Describes how a log statement argument is encoded in a binary log record. Arguments without a binary
+ * encoding (e.g. protocols or array slices) are skipped, and are shown as '-' in the record's format.
+ *
+ * Codes are: 's' string ID (2 bytes), 'c' char, '?' bool, 'B'/'b' 'H'/'h' 'I'/'i' decimal uint8/int8, uint16/int16,
+ * uint32/int32, and '1' '2' '4' for hexadecimal or raw integers of that many bytes. All values are little-endian.
+ */
+template <typename T, typename check = void>
+struct BinaryArg {
+    static constexpr char code = '-';
+    static StringInProgmem<0> *encode(T) { return irqus::typestring<>::instance(); }
+};
+
+template <uint8_t length>
+struct BinaryArg<StringInProgmem<length> *> {
+    static constexpr char code = 's';
+    static uint16_t encode(StringInProgmem<length> *s) { return binaryId((const char *) s); }
+};
+
+template <typename T, char c>
+struct BinaryValue {
+    static constexpr char code = c;
+    static T encode(T t) { return t; }
+};
+
+template <typename T>
+struct BinaryArg<T, typename std::enable_if<std::is_integral<T>::value>::type>: public BinaryValue<T, char('0' + sizeof(T))> {};
+template <> struct BinaryArg<char>: public BinaryValue<char, 'c'> {};
+template <> struct BinaryArg<bool>: public BinaryValue<bool, '?'> {};
+
+template <typename T, char c>
+struct BinaryDecimal {
+    static constexpr char code = c;
+    static T encode(Streams::Impl::Decimal<T> d) { return d.value; }
+};
+
+template <> struct BinaryArg<Streams::Impl::Decimal<uint8_t>>: public BinaryDecimal<uint8_t, 'B'> {};
+template <> struct BinaryArg<Streams::Impl::Decimal<int8_t>>: public BinaryDecimal<int8_t, 'b'> {};
+template <> struct BinaryArg<Streams::Impl::Decimal<uint16_t>>: public BinaryDecimal<uint16_t, 'H'> {};
+template <> struct BinaryArg<Streams::Impl::Decimal<int16_t>>: public BinaryDecimal<int16_t, 'h'> {};
+template <> struct BinaryArg<Streams::Impl::Decimal<uint32_t>>: public BinaryDecimal<uint32_t, 'I'> {};
+template <> struct BinaryArg<Streams::Impl::Decimal<int32_t>>: public BinaryDecimal<int32_t, 'i'> {};
+
+template <typename T>
+struct BinaryArg<Streams::Impl::Hexadecimal<T>, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static constexpr char code = '0' + sizeof(T);
+    static T encode(Streams::Impl::Hexadecimal<T> h) { return h.value; }
+};
+
+/**
+ * The format of all log statements with the given logger and argument types, e.g. "Tasks:sBs", stored
+ * in flash. Its ID is the first field of each binary log record.
+ */
+template <typename loggerName, typename... types>
+struct BinaryFormat;
+
+template <char... name, typename... types>
+struct BinaryFormat<irqus::typestring<name...>, types...> {
+    typedef irqus::typestring<name..., ':', BinaryArg<types>::code...> format;
+
+    static uint16_t id() {
+        return binaryId(format::data());
+    }
+};
+
+}
+
+/**
+ * Writes log statements as binary records instead of text. Each record is the 2-byte ID of the statement's
+ * format (see Impl::BinaryFormat), followed by the raw little-endian arguments, with F() strings replaced
+ * by their 2-byte ID. No formatting happens on the device, and constant strings don't cost any UART time.
+ *
+ * Use tools/logdecode.py with the application's ELF file to turn the records back into text.
+ */
+template <typename loggerName = STR("")>
+struct MessagesBinary {
+    static constexpr bool isDebugEnabled() { return true; }
+
+    /** Writes a log statement to [sink] as binary record, exactly as debug() sends it to onMessage() on AVR. */
+    template <typename sink_t, typename... types>
+    static bool writeTo(sink_t &sink, types... args) {
+        return sink.writeIfSpace(Impl::BinaryFormat<loggerName, types...>::id(), Impl::BinaryArg<types>::encode(args)...);
+    }
+#ifndef AVR
+    // Host builds have no onMessage() to send records to, so they keep logging as text.
+    template <typename... types>
+    inline static void debug(types... args) {
+        MessagesEnabled<loggerName>::debug(args...);
+    }
+    static void flush() {}
+#else
+    template <typename... types>
+    inline static void debug(types... args) {
+        onMessage(Impl::BinaryFormat<loggerName, types...>::id(), Impl::BinaryArg<types>::encode(args)...);
+    }
+
+    static void flush() {
+        onFlush();
+    }
+#endif
+};
+
 template <typename T>
 struct Log: public TimingDisabled, public MessagesDisabled{
 
@@ -152,20 +463,115 @@ struct Log: public TimingDisabled, public MessagesDisabled{
 
 namespace Logging {
 
-inline void printTimings() {
+/**
+ * Logs, through Loggers::Events, all events recorded by interrupt handlers since the previous invocation.
+ */
+inline void printEvents() {
+    using Streams::dec;
+    typedef Logging::Log<Loggers::Events> log;
+    const uint8_t dropped = Impl::events.takeDropped();
+    if (dropped > 0) {
+        log::debug(F("dropped "), dec(dropped));
+    }
+    uint8_t id;
+    uint16_t arg;
+    while (Impl::events.read(id, arg)) {
+        switch (Event(id)) {
+        case Event::RFM12_STATUS: log::debug(F("RFM12 status "), Streams::Hexadecimal(uint8_t(arg >> 8)), Streams::Hexadecimal(uint8_t(arg))); break;
+        case Event::RFM12_UNDERRUN: log::debug(F("RFM12 underrun "), dec(arg)); break;
+        case Event::TWI_STATUS: log::debug(F("TWI status "), Streams::Hexadecimal(uint8_t(arg))); break;
+        case Event::PIN_CHANGE: log::debug(F("PCINT "), Streams::Hexadecimal(uint8_t(arg >> 8)), ':', Streams::Hexadecimal(uint8_t(arg))); break;
+        default: log::debug(F("event "), dec(id), ':', dec(arg));
+        }
+    }
+}
+
+namespace Impl {
+
+template <uint8_t length>
+void printProbe(StringInProgmem<length> *name, const ProbeStats &stats) {
+    using Streams::dec;
     typedef Logging::Log<Loggers::Timing> log;
-    constexpr uint8_t MAX = 15;
-    if (debugTimingsCount > 0) {
-    	uint8_t count = (debugTimingsCount >= MAX) ? MAX : debugTimingsCount;
-		log::debug(Streams::Decimal(debugTimings, 0, count));
-		{
-			AtomicScope _;
-			for (uint8_t i = 0; i < count; i++) {
-				debugTimings[i] = debugTimings[i + count];
-			}
-			debugTimingsCount -= count;
-		}
+    if (stats.count == 0) {
+        return;
+    }
+    uint8_t buckets = ProbeStats::buckets;
+    while (stats.histogram[buckets - 1] == 0) {
+        buckets--;
     }
+    log::debug(name, F(" n="), dec(stats.count), F(" min="), dec(stats.min), F(" mean="), dec(stats.mean()),
+               F(" max="), dec(stats.max), F(" log2:"), Streams::Decimal(stats.histogram, 0, buckets));
+}
+
+template <typename log_t>
+struct has_probe {
+private:
+    template<typename U> static auto test(int) -> decltype(U::clearProbe(), std::true_type());
+    template<typename> static std::false_type test(...);
+public:
+    typedef decltype(test<log_t>(0)) type;
+};
+
+template <typename log_t>
+void printProbe(std::true_type) {
+    log_t::printProbe();
+}
+
+template <typename log_t>
+void printProbe(std::false_type) {}
+
+template <typename log_t>
+void clearProbe(std::true_type) {
+    log_t::clearProbe();
+}
+
+template <typename log_t>
+void clearProbe(std::false_type) {}
+
+/** List of loggers, terminated by void */
+template <typename... loggers>
+struct Probes;
+
+template <>
+struct Probes<void> {
+    static void print() {}
+    static void clear() {}
+};
+
+template <typename head, typename... tail>
+struct Probes<head, tail...> {
+    typedef Log<head> log_t;
+
+    static void print() {
+        printProbe<log_t>(typename has_probe<log_t>::type());
+        Probes<tail...>::print();
+    }
+
+    static void clear() {
+        clearProbe<log_t>(typename has_probe<log_t>::type());
+        Probes<tail...>::clear();
+    }
+};
+
+#define LOGGING_PROBE_TYPE(name) Loggers::name,
+typedef Probes<LOGGING_FOR_EACH_LOGGER(LOGGING_PROBE_TYPE) void> AllProbes;
+#undef LOGGING_PROBE_TYPE
+
+}
+
+/**
+ * Logs, through Loggers::Timing, the count, minimum, mean and maximum TCNT1 counts, and a log2 histogram
+ * (see ProbeStats::histogram), of each logger that has timing enabled.
+ */
+inline void printProbes() {
+    Impl::AllProbes::print();
+}
+
+/**
+ * Resets the statistics of all timing probes.
+ */
+inline void clearProbes() {
+    Impl::AllProbes::clear();
 }
 
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "gcc_type_traits.h"
+#include "Serial/Pulse.hpp"
+
+namespace Serial {
+
+namespace Impl {
+
+template <typename... decoders>
+struct DecoderChain {
+    void apply(const Pulse &pulse) {}
+};
+
+template <typename decoder_t, typename... decoders>
+struct DecoderChain<decoder_t, decoders...> {
+    typedef DecoderChain<decoders...> next_t;
+
+    decoder_t decoder;
+    next_t next;
+
+    /**
+     * An idle decoder would only reset itself on a pulse it can't match, which it already is, so the pulse
+     * doesn't need to go through its state machine.
+     */
+    static __attribute__((always_inline)) inline bool cantMatch(const Pulse &pulse) {
+        return pulse.getDuration() < decoder_t::minPulse || pulse.getDuration() > decoder_t::maxPulse;
+    }
+
+    void apply(const Pulse &pulse) {
+        if (!(cantMatch(pulse) && decoder.isIdle())) {
+            decoder.apply(pulse);
+        }
+        next.apply(pulse);
+    }
+
+    decoder_t &get(std::integral_constant<uint8_t, 0>) {
+        return decoder;
+    }
+
+    template <uint8_t idx>
+    auto &get(std::integral_constant<uint8_t, idx>) {
+        return next.get(std::integral_constant<uint8_t, idx - 1>());
+    }
+};
+
+} // namespace Impl
+
+/**
+ * Feeds every pulse from one pulse counter to several decoders, e.g. FS20 and Visonic on the same 868MHz OOK
+ * receiver:
+ *
+ *     DecoderBus<FS20Decoder<decltype(pc)>, VisonicDecoder<decltype(pc)>> bus;
+ *     pc.onMax(8, [&] (auto pulse) { bus.apply(pulse); });
+ *     FS20Packet fs20;
+ *     if (bus.decoder<0>().read(&fs20)) { ... }
+ *
+ * Each decoder keeps its own output fifo. Decoders must declare the range of pulse lengths they can match,
+ * as static constexpr minPulse and maxPulse, and an isIdle() method. Idle decoders are skipped for pulses
+ * outside of their range, which is most of them for the noise that an OOK receiver outputs between packets.
+ */
+template <typename... decoders>
+class DecoderBus {
+    Serial::Impl::DecoderChain<decoders...> chain;
+
+public:
+    void apply(const Pulse &pulse) {
+        chain.apply(pulse);
+    }
+
+    template <uint8_t idx>
+    auto &decoder() {
+        static_assert(idx < sizeof...(decoders), "Decoder index must be below the number of decoders");
+        return chain.get(std::integral_constant<uint8_t, idx>());
+    }
+};
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "HAL/Atmel/Device.hpp"
+#include "HAL/Atmel/InterruptHandlers.hpp"
+#include "AtomicScope.hpp"
+#include "Fifo.hpp"
+#include "Serial/Pulse.hpp"
+#include "Serial/PulseEncoding.hpp"
+
+namespace Serial {
+
+using namespace Time;
+using namespace HAL::Atmel::InterruptHandlers;
+
+/**
+ * Counts up/down pulse lengths on the ICP1 pin (PB0, Arduino pin D8), using the input capture unit of timer 1.
+ * Since the hardware latches TCNT1 into ICR1 on each edge, the lengths don't include the varying latency of
+ * entering the interrupt, as they do for PulseCounter. That allows for prescalers of 1 and 8, and keeps short
+ * pulses exact while other interrupts (e.g. RFM12) are running.
+ *
+ * Timer 1 must be running in normal mode, and [_comparator_t] must be one of its comparators. It reports a
+ * timeout (a pulse of length 0) when no edge has occurred for 65535 counts, just like PulseCounter.
+ * The pulses are stored in the fifo using [encoding_t], one of the types in PulseEncoding.
+ */
+template <typename _comparator_t,
+          int fifo_length = 32,
+          typename encoding_t = PulseEncoding::Wide,
+          typename capture_t = HAL::Atmel::Info::Timer1Info::InputCapture>
+class InputCapturePulseCounter {
+public:
+    typedef InputCapturePulseCounter<_comparator_t,fifo_length,encoding_t,capture_t> This;
+    typedef _comparator_t comparator_t;
+    typedef typename comparator_t::value_t count_t;
+    static_assert(sizeof(count_t) == 2, "Input capture requires a comparator on the 16-bit timer 1");
+
+private:
+    Fifo<fifo_length> fifo;
+    volatile count_t start;
+    uint8_t space;
+
+    comparator_t *const comparator;
+
+    void onCapture() {
+        const count_t end = capture_t::ICR.get();
+        const bool rising = capture_t::ICES.isSet();
+
+        // Capture the opposite edge next. Changing the edge can set ICF, which is cleared by writing a 1.
+        if (rising) {
+            capture_t::ICES.clear();
+        } else {
+            capture_t::ICES.set();
+        }
+        capture_t::ICF.set();
+
+        if (space < encoding_t::maxSize) {
+            space = fifo.fastGetSpace();
+        }
+        if (space >= encoding_t::maxSize) {
+            space -= encoding_t::fastWrite(fifo, count_t(end - start), !rising);
+        }
+
+        comparator->setTarget(count_t(end - 1));
+        comparator->interruptOn();
+        start = end;
+    }
+
+    void onComparator() {
+        // timeout, with the same level convention as PulseCounter
+        if (fifo.fastGetSpace() >= encoding_t::maxSize) {
+            encoding_t::fastWrite(fifo, count_t(0), capture_t::ICES.isSet());
+        }
+        space = 0;
+        comparator->interruptOff();
+    }
+
+    void go() {
+        if (capture_t::PIN.isSet()) {
+            capture_t::ICES.clear();
+        } else {
+            capture_t::ICES.set();
+        }
+        capture_t::ICF.set();
+        space = fifo.getSpace();
+        start = typename comparator_t::timervalue_t(comparator->getValue()).getValue();
+        comparator->setTarget(count_t(start - 1));
+        comparator->interruptOn();
+        capture_t::ICIE.set();
+    }
+
+public:
+    typedef On<This, typename comparator_t::INT, &This::onComparator,
+            On<This, typename capture_t::INT, &This::onCapture>> Handlers;
+
+    InputCapturePulseCounter(comparator_t &_comparator): comparator(&_comparator) {
+        capture_t::DDR.clear();
+        capture_t::PORT.set();
+        go();
+    }
+
+    ~InputCapturePulseCounter() {
+        pause();
+    }
+
+    void pause() {
+        comparator->interruptOff();
+        capture_t::ICIE.clear();
+    }
+
+    void resume() {
+        AtomicScope _;
+        fifo.clear();
+        go();
+    }
+
+    inline uint8_t getOverflows() {
+        return fifo.getAbortedWrites();
+    }
+
+    void clear() {
+        fifo.clear();
+    }
+
+    /** Returns whether any pulses (or timeouts) have been counted that haven't been read yet. */
+    bool hasPulses() const {
+        return fifo.hasContent();
+    }
+
+    template <typename Body>
+    inline void on(Body body) {
+        count_t length;
+        bool high;
+        if (encoding_t::read(fifo, length, high)) {
+            body(PulseOn<comparator_t>(high, length));
+        }
+    }
+
+    template <typename Body>
+    inline void onMax(uint8_t maxPulses, Body body) {
+        for (uint8_t i = maxPulses; i > 0; i--) {
+            count_t length;
+            bool high;
+            if (encoding_t::read(fifo, length, high)) {
+                body(PulseOn<comparator_t>(high, length));
+            } else {
+                return;
+            }
+        }
+    }
+};
+
+template <int fifo_length = 128, typename encoding_t = PulseEncoding::Wide, typename comparator_t>
+inline InputCapturePulseCounter<comparator_t,fifo_length,encoding_t> inputCapturePulseCounter(comparator_t &comparator) {
+    return InputCapturePulseCounter<comparator_t,fifo_length,encoding_t>(comparator);
+}
+
+}
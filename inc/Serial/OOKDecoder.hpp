@@ -0,0 +1,289 @@
+#pragma once
+
+#include <util/parity.h>
+#include "Fifo.hpp"
+#include "HAL/attributes.hpp"
+#include "Serial/Pulse.hpp"
+#include "Serial/SerialTx.hpp"
+#include "typestring.hh"
+
+namespace Serial {
+
+/** A pulse that's part of a protocol: its level, and the range of lengths (in timer counts, inclusive) it's accepted for. */
+struct PulseSpec {
+    bool high;
+    uint16_t min;
+    uint16_t max;
+
+    bool matches(const Pulse &pulse) const {
+        return pulse.isHigh() == high && pulse.getDuration() >= min && pulse.getDuration() <= max;
+    }
+};
+
+/**
+ * Description of an on/off keyed protocol, from which OOKDecoder decodes packets. A packet is received as:
+ *
+ *  - [header]: a fixed sequence of pulses, e.g. the 9ms + 4.5ms leader of NEC. Instead of the header, [repeat]
+ *    may be received, which is a complete packet by itself, e.g. NEC's repeat code.
+ *  - [syncBits]: at least this many zero bits, followed by a one bit, e.g. the FS20 preamble.
+ *  - data bytes, each bit being a pair of pulses ([zero] or [one]), sent in [bitOrder], with a parity bit after
+ *    every byte unless [parity] is NONE.
+ *
+ * After every byte, [packetBytes] is invoked with the bytes received so far, and returns how many bytes the whole
+ * packet has. The complete packet is kept if all parity bits were correct and [isValid] (e.g. a checksum, may be
+ * nullptr) returns true.
+ *
+ * Timings are in counts of the pulse counter's timer, so a protocol is typically a constexpr function
+ * templated on that timer. OOKDecoder keeps it in PROGMEM.
+ */
+struct OOKProtocol {
+    static constexpr uint8_t maxHeader = 3;
+    static constexpr uint8_t maxBytes = 8;
+
+    PulseSpec header[maxHeader];
+    uint8_t headerLength;
+    PulseSpec repeat[maxHeader];
+    uint8_t repeatLength;
+    uint8_t syncBits;
+
+    PulseSpec zero[2];
+    PulseSpec one[2];
+    SerialBitOrder bitOrder;
+    SerialParity parity;
+
+    uint8_t (*packetBytes)(const uint8_t *data, uint8_t bytes);
+    bool (*isValid)(const uint8_t *data, uint8_t bytes);
+
+    /** The shortest pulse that can be part of a packet. */
+    constexpr uint16_t minPulse() const {
+        uint16_t result = zero[0].min;
+        const PulseSpec bits[] = { zero[1], one[0], one[1] };
+        for (const PulseSpec &p: bits) {
+            if (p.min < result) result = p.min;
+        }
+        for (uint8_t i = 0; i < headerLength; i++) {
+            if (header[i].min < result) result = header[i].min;
+        }
+        for (uint8_t i = 0; i < repeatLength; i++) {
+            if (repeat[i].min < result) result = repeat[i].min;
+        }
+        return result;
+    }
+
+    /** The longest pulse that can be part of a packet. */
+    constexpr uint16_t maxPulse() const {
+        uint16_t result = zero[0].max;
+        const PulseSpec bits[] = { zero[1], one[0], one[1] };
+        for (const PulseSpec &p: bits) {
+            if (p.max > result) result = p.max;
+        }
+        for (uint8_t i = 0; i < headerLength; i++) {
+            if (header[i].max > result) result = header[i].max;
+        }
+        for (uint8_t i = 0; i < repeatLength; i++) {
+            if (repeat[i].max > result) result = repeat[i].max;
+        }
+        return result;
+    }
+};
+
+namespace Impl {
+
+template <typename T>
+T readProgmem(const T &t) {
+    T result;
+    uint8_t *dst = (uint8_t *) &result;
+    const uint8_t *src = (const uint8_t *) &t;
+    for (uint8_t i = 0; i < sizeof(T); i++) {
+        dst[i] = pgm_read_byte(src + i);
+    }
+    return result;
+}
+
+}
+
+/**
+ * Decodes packets of any on/off keyed protocol that can be described by an OOKProtocol. [format_t] describes
+ * the protocol, and must have:
+ *
+ *  - typedef packet_t, the type of decoded packets
+ *  - template <typename prescaled_t> static constexpr OOKProtocol protocol(), the protocol for timer [prescaled_t]
+ *  - static packet_t toPacket(const uint8_t *data, uint8_t bytes), creating a packet from its received bytes. It's
+ *    invoked with 0 bytes for a repeat.
+ *
+ * Decoded packets are kept in a fifo, to be read by read(). The decoder also declares the range of pulses
+ * it can match, so it can be put on a DecoderBus.
+ */
+template <typename prescaled_t, typename format_t, uint8_t fifoSize = 32>
+class OOKDecoder {
+    typedef typename format_t::packet_t packet_t;
+
+    enum class State: uint8_t { IDLE, HEADER, SYNC, DATA };
+
+public:
+    static constexpr OOKProtocol protocol PROGMEM = format_t::template protocol<prescaled_t>();
+    static constexpr uint16_t minPulse = protocol.minPulse();
+    static constexpr uint16_t maxPulse = protocol.maxPulse();
+
+private:
+    static_assert(protocol.headerLength <= OOKProtocol::maxHeader && protocol.repeatLength <= OOKProtocol::maxHeader,
+            "Header and repeat can have at most OOKProtocol::maxHeader pulses");
+
+    State state = State::IDLE;
+    uint8_t pos = 0;         // pulses into the header, or zero bits into the sync
+    bool maybeHeader = false;
+    bool maybeRepeat = false;
+    bool haveFirstPulse = false;
+    bool firstIsZero = false;
+    bool firstIsOne = false;
+    uint8_t bit = 0;
+    uint8_t bytes = 0;
+    bool parityError = false;
+    uint8_t data[OOKProtocol::maxBytes] = {};
+    Fifo<fifoSize> fifo;
+
+    void reset() {
+        state = State::IDLE;
+        haveFirstPulse = false;
+    }
+
+    void emit(uint8_t length) {
+        const packet_t packet = format_t::toPacket(data, length);
+        fifo.write(&packet);
+    }
+
+    void startData() {
+        state = State::DATA;
+        bit = 0;
+        bytes = 0;
+        parityError = false;
+        data[0] = 0;
+    }
+
+    void startBits() {
+        if (protocol.syncBits > 0) {
+            state = State::SYNC;
+            pos = 0;
+        } else {
+            startData();
+        }
+    }
+
+    bool applyHeader(const Pulse &pulse) {
+        maybeHeader = maybeHeader && pos < protocol.headerLength &&
+                Serial::Impl::readProgmem(protocol.header[pos]).matches(pulse);
+        maybeRepeat = maybeRepeat && pos < protocol.repeatLength &&
+                Serial::Impl::readProgmem(protocol.repeat[pos]).matches(pulse);
+        pos++;
+        if (maybeRepeat && pos == protocol.repeatLength) {
+            emit(0);
+            reset();
+        } else if (maybeHeader && pos == protocol.headerLength) {
+            startBits();
+        }
+        return maybeHeader || maybeRepeat;
+    }
+
+    bool applySyncBit(bool one) {
+        if (!one) {
+            if (pos < 255) {
+                pos++;
+            }
+            return true;
+        } else if (pos >= protocol.syncBits) {
+            startData();
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    void byteComplete() {
+        bit = 0;
+        bytes++;
+        const auto packetBytes = Serial::Impl::readProgmem(protocol.packetBytes);
+        const uint8_t length = packetBytes(data, bytes);
+        if (bytes >= length || bytes >= OOKProtocol::maxBytes) {
+            const auto isValid = Serial::Impl::readProgmem(protocol.isValid);
+            if (!parityError && (isValid == nullptr || isValid(data, bytes))) {
+                emit(bytes);
+            }
+            reset();
+        } else {
+            data[bytes] = 0;
+        }
+    }
+
+    bool applyDataBit(bool one) {
+        if (bit == 8) {
+            const bool even = parity_even_bit(data[bytes]);
+            if (one != ((protocol.parity == SerialParity::EVEN) ? even : !even)) {
+                parityError = true;
+            }
+            byteComplete();
+        } else {
+            if (protocol.bitOrder == SerialBitOrder::MSB_FIRST) {
+                data[bytes] = (data[bytes] << 1) | (one ? 1 : 0);
+            } else if (one) {
+                data[bytes] |= (1 << bit);
+            }
+            bit++;
+            if (bit == 8 && protocol.parity == SerialParity::NONE) {
+                byteComplete();
+            }
+        }
+        return true;
+    }
+
+    bool applyBitPulse(const Pulse &pulse) {
+        if (!haveFirstPulse) {
+            firstIsZero = Serial::Impl::readProgmem(protocol.zero[0]).matches(pulse);
+            firstIsOne = Serial::Impl::readProgmem(protocol.one[0]).matches(pulse);
+            haveFirstPulse = firstIsZero || firstIsOne;
+            return haveFirstPulse;
+        }
+        haveFirstPulse = false;
+        bool one;
+        if (firstIsZero && Serial::Impl::readProgmem(protocol.zero[1]).matches(pulse)) {
+            one = false;
+        } else if (firstIsOne && Serial::Impl::readProgmem(protocol.one[1]).matches(pulse)) {
+            one = true;
+        } else {
+            return false;
+        }
+        return (state == State::SYNC) ? applySyncBit(one) : applyDataBit(one);
+    }
+
+public:
+    /** Returns whether the decoder is waiting for the start of a packet, i.e. any stray pulse leaves it as is. */
+    bool isIdle() const {
+        return state == State::IDLE;
+    }
+
+    void apply(const Pulse &pulse) {
+        if (state == State::IDLE) {
+            if (protocol.headerLength > 0) {
+                state = State::HEADER;
+                pos = 0;
+                maybeHeader = true;
+                maybeRepeat = protocol.repeatLength > 0;
+            } else {
+                startBits();
+            }
+        }
+
+        const bool matched = (state == State::HEADER) ? applyHeader(pulse) : applyBitPulse(pulse);
+        if (!matched) {
+            reset();
+        }
+    }
+
+    inline Streams::ReadResult read(packet_t *packet) {
+        return fifo.read(packet);
+    }
+};
+
+template <typename prescaled_t, typename format_t, uint8_t fifoSize>
+constexpr OOKProtocol OOKDecoder<prescaled_t, format_t, fifoSize>::protocol;
+
+}
@@ -9,6 +9,7 @@
 #define SERIAL_PULSE_HPP_
 
 #include "Streams/Format.hpp"
+#include "Streams/Protocol.hpp"
 #include "Time/Units.hpp"
 
 namespace Serial {
@@ -12,6 +12,7 @@
 #include "Fifo.hpp"
 #include "HAL/Atmel/Timer.hpp"
 #include "Serial/Pulse.hpp"
+#include "Serial/PulseEncoding.hpp"
 #include "Logging.hpp"
 
 extern volatile uint16_t pls;
@@ -22,18 +23,20 @@ using namespace Time;
 using namespace HAL::Atmel::InterruptHandlers;
 
 
-// TODO make a version that uses rt instead of comparator for timeout. That way,
-// many pulse counters can share 1 timer.
+// See SharedPulseCounter for a version that uses rt instead of a comparator for timeouts,
+// so many pulse counters can share 1 timer.
 
 /**
- * Counts up/down pulse lengths on a pin by using a timer.
+ * Counts up/down pulse lengths on a pin by using a timer. The pulses are stored in the fifo
+ * using [encoding_t], one of the types in PulseEncoding.
  */
 template <typename _comparator_t,
           typename pin_t,
-          int fifo_length = 32>
+          int fifo_length = 32,
+          typename encoding_t = PulseEncoding::Wide>
 class PulseCounter {
 public:
-    typedef PulseCounter<_comparator_t,pin_t,fifo_length> This;
+    typedef PulseCounter<_comparator_t,pin_t,fifo_length,encoding_t> This;
     typedef _comparator_t comparator_t;
     typedef typename comparator_t::timervalue_t count_t;
     PulseCounter (const This &) = default;
@@ -58,13 +61,11 @@ private:
         const count_t length = (end > start) ? end - start :
                                count_t::maximum() - (start - end);
 
-    	if (space <= 2) {
+    	if (space < encoding_t::maxSize) {
     		space = fifo.fastGetSpace();
     	}
-    	if (space > 2) {
-    		//fifo.fastwrite(length, uint8_t(pin->isHigh() ? 0 : 1));
-    		fifo.fastUncheckedWrite(length.getValue());
-    		fifo.fastUncheckedWrite(uint8_t(pin->isHigh() ? 0 : 1));
+    	if (space >= encoding_t::maxSize) {
+    		space -= encoding_t::fastWrite(fifo, length.getValue(), !pin->isHigh());
     	}
 
         //log::debug(F("P s="), dec(start), F(" e="), dec(end), F(" l="), dec(lastWriteWasHigh));
@@ -78,7 +79,10 @@ private:
     void onComparator() {
         //log::debug(F("C e="), dec(wasEmptyPeriod), F(" p="), dec(pin->isHigh()), F(" l="), dec(lastWriteWasHigh));
         // timeout
-        fifo.fastwrite((count_t) 0, uint8_t(pin->isHigh() ? 0 : 1));
+        if (fifo.fastGetSpace() >= encoding_t::maxSize) {
+            encoding_t::fastWrite(fifo, typename count_t::value_t(0), !pin->isHigh());
+        }
+        space = 0;
         comparator->interruptOff();
     }
 
@@ -123,22 +127,27 @@ public:
         go();
     }
 
+    /** Returns whether any pulses (or timeouts) have been counted that haven't been read yet. */
+    bool hasPulses() const {
+        return fifo.hasContent();
+    }
+
     template <typename Body>
     inline void on(Body body) {
-        typename count_t::value_t length ;
-        uint8_t value;
-        if (fifo.read(&length, &value)) {
-            body(PulseOn<_comparator_t>(value == 1, length));
+        typename count_t::value_t length;
+        bool high;
+        if (encoding_t::read(fifo, length, high)) {
+            body(PulseOn<_comparator_t>(high, length));
         }
     }
 
     template <typename Body>
     inline void onMax(uint8_t maxPulses, Body body) {
         for (uint8_t i = maxPulses; i > 0; i--) {
-        	typename count_t::value_t length ;
-            uint8_t value;
-            if (fifo.read(&length, &value)) {
-                body(PulseOn<_comparator_t>(value == 1, length));
+            typename count_t::value_t length;
+            bool high;
+            if (encoding_t::read(fifo, length, high)) {
+                body(PulseOn<_comparator_t>(high, length));
             } else {
                 return;
             }
@@ -146,9 +155,9 @@ public:
     }
 };
 
-template <int fifo_length = 128, typename _comparator_t, typename pin_t>
-inline PulseCounter<_comparator_t,pin_t,fifo_length> pulseCounter(_comparator_t &comparator, pin_t &pin) {
-    return PulseCounter<_comparator_t,pin_t,fifo_length>(comparator, pin);
+template <int fifo_length = 128, typename encoding_t = PulseEncoding::Wide, typename _comparator_t, typename pin_t>
+inline PulseCounter<_comparator_t,pin_t,fifo_length,encoding_t> pulseCounter(_comparator_t &comparator, pin_t &pin) {
+    return PulseCounter<_comparator_t,pin_t,fifo_length,encoding_t>(comparator, pin);
 }
 
 /**
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Serial {
+
+/**
+ * Ways in which a pulse counter can store pulses in its fifo. Each encoding has:
+ *
+ *  - maxSize: the most bytes a single pulse can take. Interrupt handlers only write a pulse if the fifo
+ *    has at least that much space.
+ *  - fastWrite(fifo, length, high): writes one pulse from an interrupt handler, and returns the bytes written.
+ *  - read(fifo, length, high): reads one pulse back, returning false if the fifo was empty.
+ *
+ * A length of 0 denotes a timeout, and is always stored exactly.
+ */
+namespace PulseEncoding {
+
+/**
+ * Stores the full timer value, followed by a level byte. That's 3 bytes per pulse on 16-bit timers,
+ * and 2 bytes on 8-bit timers.
+ */
+struct Wide {
+    static constexpr uint8_t maxSize = 3;
+
+    template <typename fifo_t, typename value_t>
+    static __attribute__((always_inline)) inline uint8_t fastWrite(fifo_t &fifo, value_t length, bool high) {
+        fifo.fastUncheckedWrite(length);
+        fifo.fastUncheckedWrite(uint8_t(high ? 1 : 0));
+        return sizeof(value_t) + 1;
+    }
+
+    template <typename fifo_t, typename value_t>
+    static bool read(fifo_t &fifo, value_t &length, bool &high) {
+        uint8_t value;
+        if (fifo.read(&length, &value)) {
+            high = (value == 1);
+            return true;
+        } else {
+            return false;
+        }
+    }
+};
+
+/**
+ * Stores a pulse as a single byte, with its level in the top bit, and its length in the lower 7 bits, as
+ * a multiple of 2^unitPower2 timer counts (rounded to nearest). Pulses of 127 units or longer are escaped
+ * by 127 in the lower 7 bits, followed by their exact 16-bit length, taking 3 bytes.
+ *
+ * The unit is a power of 2, so the interrupt handler only has to shift. Pick it so that the pulses of interest
+ * fit in 126 units, e.g. using unitPower2For().
+ */
+template <uint8_t unitPower2>
+struct Compact {
+    static constexpr uint8_t maxSize = 3;
+    static constexpr uint8_t escape = 127;
+    static constexpr uint8_t high_bit = 0x80;
+
+    /** Returns the first byte for a pulse. If its lower 7 bits are [escape], the 16-bit length must follow. */
+    template <typename value_t>
+    static __attribute__((always_inline)) inline uint8_t toByte(value_t length, bool high) {
+        const uint16_t units = (uint16_t(length) + ((1 << unitPower2) >> 1)) >> unitPower2;
+        const uint8_t level = high ? high_bit : 0;
+        if (units < escape) {
+            // don't let short pulses round down to 0, since that would make them a timeout
+            return uint8_t(level | ((units == 0 && length != 0) ? 1 : units));
+        } else {
+            return uint8_t(level | escape);
+        }
+    }
+
+    template <typename fifo_t, typename value_t>
+    static __attribute__((always_inline)) inline uint8_t fastWrite(fifo_t &fifo, value_t length, bool high) {
+        const uint8_t b = toByte(length, high);
+        fifo.fastUncheckedWrite(b);
+        if ((b & ~high_bit) == escape) {
+            fifo.fastUncheckedWrite(uint16_t(length));
+            return 3;
+        } else {
+            return 1;
+        }
+    }
+
+    template <typename fifo_t, typename value_t>
+    static bool read(fifo_t &fifo, value_t &length, bool &high) {
+        uint8_t b;
+        if (!fifo.read(&b)) {
+            return false;
+        }
+        high = (b & high_bit) != 0;
+        b &= ~high_bit;
+        if (b == escape) {
+            uint16_t l = 0;
+            fifo.read(&l);
+            length = l;
+        } else {
+            length = value_t(uint16_t(b) << unitPower2);
+        }
+        return true;
+    }
+};
+
+/** Returns the smallest unit for Compact that still fits pulses of [counts] in a single byte. */
+constexpr uint8_t unitPower2For(uint32_t counts, uint8_t unitPower2 = 0) {
+    return ((counts >> unitPower2) < Compact<0>::escape) ? unitPower2 : unitPower2For(counts, unitPower2 + 1);
+}
+
+}
+
+}
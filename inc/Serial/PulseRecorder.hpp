@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Serial/Pulse.hpp"
+#include "Serial/PulseEncoding.hpp"
+
+namespace Serial {
+
+/**
+ * Dumps pulses to a serial port, so real receiver output can be captured and replayed into decoders on the host
+ * (see tools/pulsetrace.py, and tst/PulseReplay.hpp):
+ *
+ *     auto recorder = pulseRecorder<4>(pc, pinTX);
+ *     recorder.start();
+ *     pc.onMax(8, [&] (auto pulse) { recorder.apply(pulse); });
+ *
+ * A trace starts with a 5-byte header: 'P', 'T', the CPU clock in MHz, the timer's prescalerPower2, and
+ * unitPower2. Pulses follow, one byte each as in PulseEncoding::Compact<unitPower2>, with long ones escaped
+ * to 3 bytes. A byte whose lower 7 bits are 0 is a timeout (0x00, or 0x80 for a timeout while high). It's also
+ * written in place of any pulses that were dropped because the serial port couldn't keep up, so decoders see a gap
+ * rather than two unrelated pulses being stitched together.
+ */
+template <typename target_t, typename prescaled_t, uint8_t unitPower2>
+class PulseRecorder {
+    typedef PulseEncoding::Compact<unitPower2> encoding_t;
+
+    target_t *target;
+    bool dropped = false;
+    uint16_t droppedPulses = 0;
+
+    bool write(const Pulse &pulse) {
+        const uint8_t b = encoding_t::toByte(pulse.getDuration(), pulse.isHigh());
+        if ((b & ~encoding_t::high_bit) == encoding_t::escape) {
+            return target->writeIfSpace(b, pulse.getDuration());
+        } else {
+            return target->writeIfSpace(b);
+        }
+    }
+
+public:
+    PulseRecorder(target_t &t): target(&t) {}
+
+    /** Writes the trace header, e.g. at startup, or again whenever the host might have started listening. */
+    bool start() {
+        return target->writeIfSpace('P', 'T', uint8_t(F_CPU / 1000000), uint8_t(prescaled_t::prescalerPower2),
+                uint8_t(unitPower2));
+    }
+
+    void apply(const Pulse &pulse) {
+        if (dropped) {
+            if (!write(Pulse::empty())) {
+                droppedPulses++;
+                return;
+            }
+            dropped = false;
+        }
+        if (!write(pulse)) {
+            dropped = true;
+            droppedPulses++;
+        }
+    }
+
+    /** Returns the number of pulses that didn't fit in the serial port's buffer. */
+    uint16_t getDroppedPulses() const {
+        return droppedPulses;
+    }
+};
+
+template <uint8_t unitPower2, typename pulsecounter_t, typename target_t>
+PulseRecorder<target_t, typename pulsecounter_t::comparator_t, unitPower2> pulseRecorder(const pulsecounter_t &pc, target_t &target) {
+    return { target };
+}
+
+}
@@ -14,8 +14,10 @@ namespace Serial {
 
 struct RS232 {
 private:
-    static const uint8_t prefix[];
-    static const uint8_t postfix[];
+    // Start bit is always low
+    static constexpr uint8_t prefix[] = { 0b0 };
+    // Stop bit(s) are always high
+    static constexpr uint8_t postfix[] = { 0b11 };
 public:
     template <typename prescaled_t, uint32_t bits_per_second = 57600>
     struct _8n1 {
@@ -37,6 +39,9 @@ public:
     };
 };
 
+template <typename prescaled_t, uint32_t bits_per_second>
+constexpr SerialConfig RS232::_8n1<prescaled_t, bits_per_second>::serialconfig;
+
 }
 
 #endif /* RS232_HPP_ */
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Fifo.hpp"
+#include "Time/UnitLiterals.hpp"
+#include "HAL/Atmel/InterruptHandlers.hpp"
+
+namespace Serial {
+
+namespace Impl {
+
+using namespace HAL::Atmel::InterruptHandlers;
+using namespace Time;
+
+/**
+ * Receives 8N1 serial data on any pin that can interrupt on a falling edge (INT0/1 or PCINT), using a timer
+ * comparator to sample the line in the middle of each bit. Received bytes go into a fifo, to be read using
+ * the Streams API. The comparator and the pin interrupt are both busy while a byte is being received, so they
+ * can't be shared with anything else that needs them at the same time.
+ */
+template <typename pin_t, typename comparator_t, uint32_t baudrate, uint8_t fifoSize>
+class RS232Rx: public Streams::Impl::ReadingDelegate<AbstractFifo> {
+public:
+    typedef typename comparator_t::value_t count_t;
+    typedef RS232Rx<pin_t, comparator_t, baudrate, fifoSize> This;
+
+    static constexpr count_t bitLength = dividedBy<baudrate>((1_s).toCountsOn<comparator_t>()).getValue();
+    static_assert(bitLength > 5, "Bit length is too low. Decrease baudrate, or decrease timer prescaler.");
+
+private:
+    /** The bit sampled on the next comparator interrupt: 0 is the start bit, 1..8 are data, and 9 is the stop bit. */
+    static constexpr uint8_t stopBit = 9;
+
+    pin_t *pin;
+    comparator_t *comparator;
+    Fifo<fifoSize> fifo;
+    volatile uint8_t bit = 0;
+    uint8_t data = 0;
+    volatile uint8_t framingErrors = 0;
+
+    void waitForStartBit() {
+        comparator->interruptOff();
+        pin->interruptOnFalling();
+    }
+
+    void onPinFalling() {
+        // Sample the start bit again halfway through, so short spikes on the line aren't taken as a byte.
+        comparator->setTarget(comparator->getValue() + count_t(bitLength / 2));
+        comparator->interruptOn();
+        pin->interruptOff();
+        bit = 0;
+    }
+
+    void onComparator() {
+        const bool high = pin->isHigh();
+        if (bit == 0) {
+            if (high) {
+                waitForStartBit();
+                return;
+            }
+        } else if (bit < stopBit) {
+            data = (data >> 1) | (high ? 0x80 : 0);
+        } else {
+            if (high) {
+                fifo.fastwrite(data);
+            } else {
+                framingErrors++;
+            }
+            waitForStartBit();
+            return;
+        }
+        bit++;
+        comparator->setTarget(comparator->getTarget() + bitLength);
+    }
+
+public:
+    typedef On<This, typename comparator_t::INT, &This::onComparator,
+            On<This, typename pin_t::INT, &This::onPinFalling>> Handlers;
+
+    RS232Rx(pin_t &p, comparator_t &c): Streams::Impl::ReadingDelegate<AbstractFifo>(&fifo), pin(&p), comparator(&c) {
+        pin->configureAsInputWithPullup();
+        waitForStartBit();
+    }
+
+    /** Returns the number of bytes that had a low stop bit, and were dropped. */
+    uint8_t getFramingErrors() const {
+        return framingErrors;
+    }
+};
+
+}
+
+template <uint32_t baudrate = 9600, uint8_t fifoSize = 32, typename pin_t, typename comparator_t>
+Impl::RS232Rx<pin_t, comparator_t, baudrate, fifoSize> RS232Rx(pin_t &pin, comparator_t &comparator) {
+    return { pin, comparator };
+}
+
+}
@@ -6,7 +6,9 @@
 #include "Time/UnitLiterals.hpp"
 #include "HAL/Atmel/InterruptHandlers.hpp"
 #include "HAL/Atmel/Registers.hpp"
+#include "HAL/attributes.hpp"
 #include "Logging.hpp"
+#include "typestring.hh"
 
 #define SAFE
 
@@ -20,6 +22,58 @@ using namespace HAL::Atmel::InterruptHandlers;
 using namespace Time;
 using namespace Streams;
 
+/**
+ * The runs of equal bits that RS232Tx sends for each byte value: the start bit, 8 data bits LSB first, and the
+ * stop bit. Each run is a 3-bit code, the first run in the lowest bits, followed by [end]. Runs of more than 4
+ * bits are split, with a [split] code in between, since the comparator times at most 4 bits at once.
+ */
+struct RS232TxRuns {
+    static constexpr uint8_t bits = 3;
+    static constexpr uint8_t mask = (1 << bits) - 1;
+    static constexpr uint8_t end = 0;
+    static constexpr uint8_t split = 5;
+
+    uint32_t runs[256];
+
+    static constexpr uint32_t encode(uint8_t byte) {
+        const uint16_t frame = 0x200 | (uint16_t(byte) << 1);
+        uint32_t result = 0;
+        uint8_t shift = 0;
+        uint8_t length = 1;
+        for (uint8_t bit = 1; bit < 10; bit++) {
+            if (((frame >> bit) & 1) != ((frame >> (bit - 1)) & 1)) {
+                result |= uint32_t(length) << shift;
+                shift += bits;
+                length = 1;
+            } else if (length < 4) {
+                length++;
+            } else {
+                result |= (uint32_t(length) | (uint32_t(split) << bits)) << shift;
+                shift += 2 * bits;
+                length = 1;
+            }
+        }
+        return result | (uint32_t(length) << shift);
+    }
+
+    constexpr RS232TxRuns(): runs() {
+        for (uint16_t byte = 0; byte < 256; byte++) {
+            runs[byte] = encode(byte);
+        }
+    }
+
+    static uint32_t read(uint8_t byte);
+};
+
+/** Kept in flash, since the runs of a byte are needed right at the boundary between two bytes. */
+extern const RS232TxRuns rs232TxRuns PROGMEM;
+
+inline uint32_t RS232TxRuns::read(uint8_t byte) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(rs232TxRuns.runs + byte);
+    return uint32_t(pgm_read_byte(p)) | (uint32_t(pgm_read_byte(p + 1)) << 8) |
+           (uint32_t(pgm_read_byte(p + 2)) << 16) | (uint32_t(pgm_read_byte(p + 3)) << 24);
+}
+
 template <typename pin_t, uint32_t baudrate, uint8_t fifoSize>
 class RS232Tx {
 	typedef Logging::Log<Loggers::RS232Tx> log;
@@ -35,92 +89,23 @@ public:
 	Fifo<fifoSize> fifo;
 
 	volatile bool transmitting = false;
-	volatile count_t lengths[10] = {}; // worst case start bit + 8 up/down bits + stop bit
-	volatile uint8_t max = 0;
-	volatile uint8_t pos = 0;
+	volatile uint32_t runs = 0; // the current run in the lowest bits, see RS232TxRuns
 	volatile bool outHigh = true;
 
+	static constexpr uint8_t nextRun(uint32_t r) {
+		return (r >> RS232TxRuns::bits) & RS232TxRuns::mask;
+	}
+
 	inline __attribute__((always_inline)) void nextByte(uint8_t byte) {
     	log::debug(F("next "), dec(uint16_t(pin->timerComparator().getValue())));
 
-		max = 0;
-		bool high = false;  // is the output currently high?
-		lengths[max] = 1;     // we're low during the start bit
-		for (uint8_t bit = 0; bit < 3; bit++) {
-			// bits 0..2 can't produce a length > 4
-			//std::cout << "bit " << int(bit) << ": " << ((byte & 1) != 0) << "/" << high << std::endl;
-			if (((byte & 1) != 0) != high) {
-				high = !high;
-				max++;
-				lengths[max] = 1;
-			} else {
-				lengths[max]++;
-			}
-			byte >>= 1;
-		}
-		for (uint8_t bit = 3; bit < 7; bit++) {
-			// bits 3..6 need a length check
-			//std::cout << "bit " << int(bit) << ": " << ((byte & 1) != 0) << "/" << high << std::endl;
-			if (((byte & 1) != 0) != high) {
-				high = !high;
-				max++;
-				lengths[max] = 1;
-			} else {
-				if (lengths[max] < 4) {
-					lengths[max]++;
-				} else {
-					max++;
-					lengths[max] = 0;
-					max++;
-					lengths[max] = 1;
-				}
-			}
-			byte >>= 1;
-		}
-		// last data bit
-		//std::cout << "bit 7: " << ((byte & 1) != 0) << "/" << high << std::endl;
-		if (((byte & 1) != 0) != high) {
-			high = !high;
-			max++;
-			lengths[max] = 1;
-		} else {
-			if (lengths[max] < 4) {
-				lengths[max]++;
-			} else {
-				max++;
-				lengths[max] = 0;
-				max++;
-				lengths[max] = 1;
-			}
-		}
-		// stop bit (must be high)
-		if (byte & 1) {
-			// last data bit was also high -> lengthen
-			if (lengths[max] < 4) {
-				lengths[max]++;
-			} else {
-				max++;
-				lengths[max] = 0;
-				max++;
-				lengths[max] = 1;
-			}
-		} else {
-			// last data bit was low -> new transition
-			max++;
-			lengths[max] = 1;
-		}
-		for (uint8_t i = 0; i <= max; i++) {
-			//std::cout << int(i) << ": " << int(lengths[i]) << " -> " << int(bitLengths[lengths[i]]) << std::endl;
-			lengths[i] = bitLengths[lengths[i]];
-		}
-		pos = 0;
+		// Looking up the runs, rather than working them out bit by bit, keeps the stop bit from being stretched.
+		const uint32_t r = RS232TxRuns::read(byte);
+		runs = r;
 
 		AtomicScope _;
 		auto startValue = pin->timerComparator().getValue();
-		//log::debug('s', dec(startValue), 'l', dec(lengths[pos]));
-		//std::cout << "start: " << int(startValue) << std::endl;
-		//std::cout << "length: " << int(lengths[pos]) << std::endl;
-		pin->timerComparator().setTarget(startValue + lengths[pos]);
+		pin->timerComparator().setTarget(startValue + bitLengths[r & RS232TxRuns::mask]);
 
 		// We make the timer do the transition. Assuming high right now.
 		pin->timerComparator().setOutput(NonPWMOutputMode::low_on_match);
@@ -128,8 +113,7 @@ public:
 		pin->setLow(); // start bit
 		outHigh = false;
 
-		//log::debug(dec(lengths[0]), ' ', dec(lengths[1]), ' ', dec(lengths[2]), ' ', dec(lengths[3]), ' ', dec(lengths[4]));
-		if ((max > pos) && (lengths[pos+1] == 0)) {
+		if (nextRun(r) == RS232TxRuns::split) {
 			// first pulse is a long one
 			pin->timerComparator().setOutput(NonPWMOutputMode::disconnected);
 		} else {
@@ -139,8 +123,7 @@ public:
 	}
 
     inline __attribute__((always_inline)) void onComparator() {
-    	log::debug('i', ' ', dec(pos), ' ', dec(lengths[pos]), ' ', '0' + outHigh);
-    	//std::cout << "1. pos: " << int(pos) << " max: " << int(max) << std::endl;
+    	log::debug('i', ' ', dec(uint8_t(runs & RS232TxRuns::mask)), ' ', '0' + outHigh);
     	log::timeStart();
 #ifdef SAFE
     	if (!transmitting) {
@@ -153,8 +136,8 @@ public:
     	}
 #endif
 
-    	pos++;
-    	if (pos > max) {
+    	uint32_t r = runs >> RS232TxRuns::bits;
+    	if ((r & RS232TxRuns::mask) == RS232TxRuns::end) {
     		uint8_t byte;
     		if (fifo.fastread(byte)) {
     			nextByte(byte);
@@ -169,16 +152,16 @@ public:
 			return;
     	}
 
-    	if (lengths[pos] == 0) {
+    	if ((r & RS232TxRuns::mask) == RS232TxRuns::split) {
 #ifdef SAFE
     		if (pin->timerComparator().getOutput() != NonPWMOutputMode::disconnected) {
     			log::debug('2');
     		}
 #endif
     		// we're entering the second half of a long pulse. Simply toggle on the next one.
-    		pos++;
+    		r >>= RS232TxRuns::bits;
 #ifdef SAFE
-    		if (pos > max) {
+    		if ((r & RS232TxRuns::mask) == RS232TxRuns::end) {
     			// this shouldn't happen
         		transmitting = false;
         		pin->timerComparator().interruptOff();
@@ -198,28 +181,23 @@ public:
     		outHigh = !outHigh;
     	}
 
-    	pin->timerComparator().setTarget(pin->timerComparator().getTarget() + lengths[pos]);
-    	//std::cout << "2. pos: " << int(pos) << " max: " << int(max) << std::endl;
-		if ((pos < max) && (lengths[pos+1] == 0)) {
-	    	//log::debug('L', dec(pos), '@', '0' + outHigh, ' ', dec(pin->timerComparator().getTarget()));
-
+    	runs = r;
+    	pin->timerComparator().setTarget(pin->timerComparator().getTarget() + bitLengths[r & RS232TxRuns::mask]);
+    	const uint8_t next = nextRun(r);
+		if (next == RS232TxRuns::split) {
 			// next pulse is a long one
 			pin->setHigh(outHigh);
 			pin->timerComparator().setOutput(NonPWMOutputMode::disconnected);
 		} else {
-			if (pos < max) {
+			if (next != RS232TxRuns::end) {
 				// normal bit
 				if (pin->timerComparator().getOutput() == NonPWMOutputMode::disconnected) {
-			    	//log::debug('C', dec(pos), ' ', dec(pin->timerComparator().getTarget()));
 					// copy current output state
 					pin->timerComparator().setOutput(outHigh ? NonPWMOutputMode::high_on_match : NonPWMOutputMode::low_on_match);
 					pin->timerComparator().applyOutput();
 					pin->timerComparator().setOutput(NonPWMOutputMode::toggle_on_match);
-				} else {
-			    	//log::debug('N', dec(pos), '@', '0' + outHigh, ' ', dec(pin->timerComparator().getTarget()));
 				}
 			} else {
-		    	//log::debug('S', dec(pos), ' ', dec(pin->timerComparator().getTarget()));
 	        	// Attempt to force OC0A output high, so it latches high on the next byte.
 				pin->timerComparator().setOutput(NonPWMOutputMode::high_on_match);
 				pin->timerComparator().applyOutput();
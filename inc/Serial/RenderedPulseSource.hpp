@@ -0,0 +1,165 @@
+#pragma once
+
+#include "AtomicScope.hpp"
+#include "Serial/Pulse.hpp"
+
+namespace Serial {
+
+/**
+ * Renders all pulses of a chunk from another pulse source (e.g. ChunkPulseSource) into a buffer, from the main
+ * loop, before sending them. PulseTx's comparator interrupt then only has to pop the next pulse, instead of
+ * running the source's bit state machine with interrupts disabled, which delays both the next edge and any
+ * other interrupt.
+ *
+ *     RenderedPulseSource<decltype(source)> rendered(source);
+ *     auto tx = pulseTx(comparator, pin, rendered);
+ *     // in the main loop:
+ *     if (rendered.render()) {
+ *         tx.sendFromSource();
+ *     }
+ *
+ * Each pulse takes one byte: its level in the top bit, and an index into a table of up to [maxDurations]
+ * distinct durations in the lower bits. Consecutive pulses of the same level are merged. A chunk that needs more
+ * than [capacity] pulses, or more than [maxDurations] durations, is dropped as a whole. The default capacity fits
+ * the longest FS20 frame, i.e. one with commandExt (80 bits, 160 pulses).
+ *
+ * Up to [chunks] rendered chunks are queued, so the next one can be rendered while the previous one is being sent.
+ */
+template <typename source_t, uint8_t capacity = 160, uint8_t maxDurations = 8, uint8_t chunks = 1>
+class RenderedPulseSource {
+    static_assert(maxDurations <= 127, "maxDurations must fit in the lower 7 bits of a pulse");
+    static_assert(chunks > 0, "at least one chunk must be queued");
+
+    static constexpr uint8_t high_bit = 0x80;
+
+    struct Chunk {
+        uint16_t durations[maxDurations] = {};
+        uint8_t pulses[capacity] = {};
+        uint8_t durationCount = 0;
+        uint8_t length = 0;
+
+        bool append(const Pulse &pulse) {
+            if (length >= capacity) {
+                return false;
+            }
+            uint8_t idx = 0;
+            while (idx < durationCount && durations[idx] != pulse.getDuration()) {
+                idx++;
+            }
+            if (idx == durationCount) {
+                if (durationCount >= maxDurations) {
+                    return false;
+                }
+                durations[durationCount++] = pulse.getDuration();
+            }
+            pulses[length++] = (pulse.isHigh() ? high_bit : 0) | idx;
+            return true;
+        }
+    };
+
+    source_t *source;
+    Chunk queue[chunks];
+    volatile uint8_t first = 0;
+    volatile uint8_t count = 0;
+    volatile uint8_t pos = 0;
+    uint8_t droppedChunks = 0;
+
+public:
+    RenderedPulseSource(source_t &_source): source(&_source) {}
+
+    /**
+     * Renders the next chunk of the source, if there's room for it in the queue. Returns whether a chunk was
+     * added, i.e. false if the queue was full, the source had no pulses, or the chunk didn't fit.
+     */
+    bool renderChunk() {
+        uint8_t idx;
+        {
+            AtomicScope _;
+            if (count >= chunks) {
+                return false;
+            }
+            idx = first + count;
+        }
+        Chunk &chunk = queue[(idx >= chunks) ? idx - chunks : idx];
+
+        chunk.durationCount = 0;
+        chunk.length = 0;
+        bool fits = true;
+        Pulse last = Pulse::empty();
+        for (Pulse pulse = source->getNextPulse(); pulse.isDefined(); pulse = source->getNextPulse()) {
+            if (last.isDefined() && last.isHigh() == pulse.isHigh() &&
+                    uint32_t(last.getDuration()) + pulse.getDuration() <= 0xFFFF) {
+                last = Pulse(last.isHigh(), last.getDuration() + pulse.getDuration());
+            } else {
+                if (last.isDefined()) {
+                    fits = fits && chunk.append(last);
+                }
+                last = pulse;
+            }
+        }
+        if (last.isDefined()) {
+            fits = fits && chunk.append(last);
+        }
+        if (!fits) {
+            droppedChunks++;
+            return false;
+        }
+        if (chunk.length == 0) {
+            return false;
+        }
+
+        AtomicScope _;
+        if (count == 0) {
+            pos = 0;
+        }
+        count++;
+        return true;
+    }
+
+    /**
+     * Renders the next chunk of the source, unless the queue is full of chunks that haven't been sent
+     * completely yet. Returns whether there are pulses ready to send.
+     */
+    bool render() {
+        renderChunk();
+        return hasPulses();
+    }
+
+    /** Returns whether a rendered chunk is waiting to be sent, or is still being sent. */
+    bool hasPulses() const {
+        return count > 0;
+    }
+
+    /** Returns whether there's room in the queue to render another chunk. */
+    bool hasSpace() const {
+        return count < chunks;
+    }
+
+    /** Returns the next rendered pulse, to be invoked by PulseTx. The end of each chunk is an empty pulse. */
+    Pulse getNextPulse() {
+        if (count == 0) {
+            return Pulse::empty();
+        }
+        const Chunk &chunk = queue[first];
+        if (pos >= chunk.length) {
+            pos = 0;
+            first = (first + 1 >= chunks) ? 0 : first + 1;
+            count = count - 1;
+            return Pulse::empty();
+        }
+        const uint8_t p = chunk.pulses[pos];
+        pos = pos + 1;
+        return Pulse((p & high_bit) != 0, chunk.durations[p & ~high_bit]);
+    }
+
+    bool isHighOnIdle() {
+        return source->isHighOnIdle();
+    }
+
+    /** Returns the number of chunks that didn't fit in the buffer, and were not sent. */
+    uint8_t getDroppedChunks() const {
+        return droppedChunks;
+    }
+};
+
+}
@@ -11,6 +11,7 @@
 #include <util/parity.h>
 #include "Serial/PulseTx.hpp"
 #include "ChunkedFifo.hpp"
+#include "AtomicScope.hpp"
 
 namespace Serial {
 
@@ -111,6 +112,182 @@ public:
     Pulse getNextPulse();
 };
 
+/**
+ * A SerialConfig that is fixed at compile time. [format_t] must have a static constexpr SerialConfig serialconfig,
+ * of which prefix and postfix point to constexpr arrays, e.g. RS232::_8n1 or FS20Packet::SerialFormat. All settings
+ * are constants, so pulse sources using this don't have to look them up, or branch on them, at runtime.
+ */
+template <typename format_t>
+struct StaticSerialConfig {
+    static constexpr const SerialConfig &config = format_t::serialconfig;
+
+    static constexpr uint32_t bitsOf(const uint8_t *bytes, uint8_t count) {
+        uint32_t result = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            result |= uint32_t((bytes[i >> 3] >> (i & 7)) & 1) << i;
+        }
+        return result;
+    }
+
+    static constexpr bool highOnIdle = config.highOnIdle;
+    static constexpr uint8_t prefixBits = config.prefix_bits;
+    static constexpr uint32_t prefix = bitsOf(config.prefix, config.prefix_bits);
+    static constexpr uint8_t postfixBits = config.postfix_bits;
+    static constexpr uint32_t postfix = bitsOf(config.postfix, config.postfix_bits);
+    static constexpr SerialParity parity = config.parity;
+    static constexpr bool msbFirst = config.bitOrder == SerialBitOrder::MSB_FIRST;
+
+    static_assert(prefixBits <= 32 && postfixBits <= 32, "Prefix and postfix can have at most 32 bits");
+
+    static constexpr Pulse pulseA(bool bit) {
+        return bit ? config.one_a : config.zero_a;
+    }
+
+    static constexpr Pulse pulseB(bool bit) {
+        return bit ? config.one_b : config.zero_b;
+    }
+
+    static constexpr bool hasPulseB(bool bit) {
+        return (bit ? config.one_b : config.zero_b).getDuration() != 0;
+    }
+};
+
+/**
+ * Outputs a single chunk at a time from a chunked fifo, like ChunkPulseSource, but with a StaticSerialConfig
+ * instead of a SerialConfig pointer at the start of each chunk. Every chunk starts with [skipBytes] bytes
+ * that aren't sent (e.g. a packet type), followed by the serial data to send.
+ */
+template <typename config_t, uint8_t skipBytes = 0>
+class StaticChunkPulseSource {
+    enum class State: uint8_t { IDLE, PREFIX, DATA, PARITY_BIT, POSTFIX };
+
+    AbstractChunkedFifo *fifo;
+    State state = State::IDLE;
+    uint8_t bitsLeft = 0;
+    uint8_t currentByte = 0;
+    uint8_t dataBits = 0;
+    uint32_t fixedBits = 0;
+    bool currentBit = false;
+    bool pulseB = false;
+
+    void startFixed(State s, uint32_t bits, uint8_t count) {
+        state = s;
+        fixedBits = bits;
+        bitsLeft = count;
+    }
+
+    bool startChunk() {
+        fifo->readStart();
+        if (!fifo->isReading()) {
+            return false;
+        }
+        for (uint8_t i = 0; i < skipBytes; i++) {
+            uint8_t skipped;
+            if (!fifo->read(&skipped)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool startDataByte() {
+        if (!fifo->hasReadAvailable()) {
+            return false;
+        }
+        fifo->read(&currentByte);
+        dataBits = currentByte;
+        state = State::DATA;
+        bitsLeft = 8;
+        return true;
+    }
+
+    bool startPostfix() {
+        if (config_t::postfixBits == 0) {
+            return false;
+        }
+        startFixed(State::POSTFIX, config_t::postfix, config_t::postfixBits);
+        return true;
+    }
+
+    bool endChunk() {
+        fifo->readEnd();
+        state = State::IDLE;
+        return false;
+    }
+
+    /** Moves on to the next bit to send, returning false when the chunk is done. */
+    bool nextBit() {
+        if (bitsLeft == 0) {
+            switch (state) {
+            case State::IDLE:
+                if (!startChunk()) {
+                    return endChunk();
+                }
+                if (config_t::prefixBits > 0) {
+                    startFixed(State::PREFIX, config_t::prefix, config_t::prefixBits);
+                    break;
+                }
+                // fall through
+            case State::PREFIX:
+                if (!startDataByte() && !startPostfix()) {
+                    return endChunk();
+                }
+                break;
+            case State::DATA:
+                if (config_t::parity != SerialParity::NONE) {
+                    const bool even = parity_even_bit(currentByte);
+                    startFixed(State::PARITY_BIT, (config_t::parity == SerialParity::EVEN) ? even : !even, 1);
+                    break;
+                }
+                // fall through
+            case State::PARITY_BIT:
+                if (!startDataByte() && !startPostfix()) {
+                    return endChunk();
+                }
+                break;
+            case State::POSTFIX:
+                return endChunk();
+            }
+        }
+
+        if (state == State::DATA) {
+            if (config_t::msbFirst) {
+                currentBit = (dataBits & 128) != 0;
+                dataBits <<= 1;
+            } else {
+                currentBit = (dataBits & 1) != 0;
+                dataBits >>= 1;
+            }
+        } else {
+            currentBit = (fixedBits & 1) != 0;
+            fixedBits >>= 1;
+        }
+        bitsLeft--;
+        return true;
+    }
+
+public:
+    StaticChunkPulseSource(AbstractChunkedFifo &_fifo): fifo(&_fifo) {}
+
+    static constexpr bool isHighOnIdle() {
+        return config_t::highOnIdle;
+    }
+
+    Pulse getNextPulse() {
+        AtomicScope _;
+
+        if (pulseB) {
+            pulseB = false;
+            return config_t::pulseB(currentBit);
+        }
+        if (!nextBit()) {
+            return Pulse::empty();
+        }
+        pulseB = config_t::hasPulseB(currentBit);
+        return config_t::pulseA(currentBit);
+    }
+};
+
 }
 
 #endif /* SERIALTX_HPP_ */
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "HAL/Atmel/InterruptHandlers.hpp"
+#include "AtomicScope.hpp"
+#include "Fifo.hpp"
+#include "Serial/Pulse.hpp"
+#include "Serial/PulseEncoding.hpp"
+
+namespace Serial {
+
+using namespace Time;
+using namespace HAL::Atmel::InterruptHandlers;
+
+/**
+ * One pin of a SharedPulseCounter. It offers the same reading API as PulseCounter, so decoders
+ * (e.g. FS20Decoder<decltype(counter.channel<0>())>) can be applied to it unchanged.
+ *
+ * Edges are timestamped with RealTimer::counts(), which makes them as precise as the real timer's prescaler,
+ * plus the latency of entering the pin interrupt. Pulses longer than 65535 counts are reported as 65535.
+ * The pulses are stored in the fifo using [encoding_t], one of the types in PulseEncoding.
+ */
+template <typename rt_t, typename pin_t, int fifo_length, typename encoding_t = PulseEncoding::Wide>
+class SharedPulseChannel {
+public:
+    typedef SharedPulseChannel<rt_t,pin_t,fifo_length,encoding_t> This;
+    typedef rt_t comparator_t;
+    typedef uint16_t count_t;
+
+    /** Number of counts without an edge after which a timeout (a pulse of length 0) is reported. */
+    static constexpr uint32_t timeout = 0xFFFF;
+
+private:
+    Fifo<fifo_length> fifo;
+    volatile uint32_t start;
+    volatile bool timedOut;
+
+    rt_t *const rt;
+    pin_t *const pin;
+
+    void onPinChanged() {
+        const uint32_t end = uint32_t(rt->counts());
+        const uint32_t length = end - start;
+
+        if (fifo.fastGetSpace() >= encoding_t::maxSize) {
+            encoding_t::fastWrite(fifo, count_t((length > 0xFFFF) ? 0xFFFF : length), !pin->isHigh());
+        }
+        start = end;
+        timedOut = false;
+    }
+
+    /**
+     * There's no comparator to interrupt on a timeout, so instead it's detected when the fifo is read,
+     * with the same level convention as PulseCounter.
+     */
+    void checkTimeout() {
+        AtomicScope _;
+        if (!timedOut && uint32_t(rt->counts()) - start > timeout) {
+            if (fifo.fastGetSpace() >= encoding_t::maxSize) {
+                encoding_t::fastWrite(fifo, count_t(0), !pin->isHigh());
+            }
+            timedOut = true;
+        }
+    }
+
+    void go() {
+        start = uint32_t(rt->counts());
+        timedOut = false;
+        pin->interruptOnChange();
+    }
+
+public:
+    typedef On<This, typename pin_t::INT, &This::onPinChanged> Handlers;
+
+    SharedPulseChannel(rt_t &_rt, pin_t &_pin): rt(&_rt), pin(&_pin) {
+        pin->configureAsInputWithPullup();
+        go();
+    }
+
+    void pause() {
+        pin->interruptOff();
+    }
+
+    void resume() {
+        AtomicScope _;
+        fifo.clear();
+        go();
+    }
+
+    inline uint8_t getOverflows() {
+        return fifo.getAbortedWrites();
+    }
+
+    void clear() {
+        fifo.clear();
+    }
+
+    /** Returns whether any pulses (or timeouts) have been counted that haven't been read yet. */
+    bool hasPulses() {
+        checkTimeout();
+        return fifo.hasContent();
+    }
+
+    template <typename Body>
+    inline void on(Body body) {
+        checkTimeout();
+        count_t length;
+        bool high;
+        if (encoding_t::read(fifo, length, high)) {
+            body(PulseOn<rt_t>(high, length));
+        }
+    }
+
+    template <typename Body>
+    inline void onMax(uint8_t maxPulses, Body body) {
+        checkTimeout();
+        for (uint8_t i = maxPulses; i > 0; i--) {
+            count_t length;
+            bool high;
+            if (encoding_t::read(fifo, length, high)) {
+                body(PulseOn<rt_t>(high, length));
+            } else {
+                return;
+            }
+        }
+    }
+};
+
+namespace Impl {
+
+template <typename rt_t, int fifo_length, typename encoding_t, typename... pins>
+struct SharedPulseChannels {
+    typedef SharedPulseChannels<rt_t,fifo_length,encoding_t,pins...> This;
+    typedef NoHandlers<This> Handlers;
+
+    SharedPulseChannels(rt_t &rt) {}
+
+    void pause() {}
+};
+
+template <typename rt_t, int fifo_length, typename encoding_t, typename pin_t, typename... pins>
+struct SharedPulseChannels<rt_t,fifo_length,encoding_t,pin_t,pins...> {
+    typedef SharedPulseChannels<rt_t,fifo_length,encoding_t,pin_t,pins...> This;
+    typedef SharedPulseChannel<rt_t,pin_t,fifo_length,encoding_t> channel_t;
+    typedef SharedPulseChannels<rt_t,fifo_length,encoding_t,pins...> next_t;
+
+    channel_t channel;
+    next_t next;
+
+    typedef Delegate<This, channel_t, &This::channel,
+            Delegate<This, next_t, &This::next>> Handlers;
+
+    SharedPulseChannels(rt_t &rt, pin_t &pin, pins &... p): channel(rt, pin), next(rt, p...) {}
+
+    void pause() {
+        channel.pause();
+        next.pause();
+    }
+
+    channel_t &get(std::integral_constant<uint8_t, 0>) {
+        return channel;
+    }
+
+    template <uint8_t idx>
+    auto &get(std::integral_constant<uint8_t, idx>) {
+        return next.get(std::integral_constant<uint8_t, idx - 1>());
+    }
+};
+
+} // namespace Impl
+
+/**
+ * Counts up/down pulse lengths on any number of pins, all timestamped from the same RealTimer, rather than
+ * needing a timer comparator for each pin like PulseCounter does. Each pin has its own fifo, and is read through
+ * channel<idx>(), with idx being the pin's position in [pins].
+ *
+ * Since the pins are only distinguished by their interrupt vectors, each pin must have its own, e.g. INT0, INT1 or
+ * a pin change interrupt bit. The pulses are stored using [encoding_t], one of the types in PulseEncoding.
+ */
+template <typename rt_t, int fifo_length, typename encoding_t, typename... pins>
+class SharedPulseCounter {
+    typedef SharedPulseCounter<rt_t,fifo_length,encoding_t,pins...> This;
+    typedef Serial::Impl::SharedPulseChannels<rt_t,fifo_length,encoding_t,pins...> channels_t;
+
+    channels_t channels;
+
+public:
+    typedef Delegate<This, channels_t, &This::channels> Handlers;
+
+    SharedPulseCounter(rt_t &rt, pins &... p): channels(rt, p...) {}
+
+    ~SharedPulseCounter() {
+        pause();
+    }
+
+    void pause() {
+        channels.pause();
+    }
+
+    template <uint8_t idx>
+    auto &channel() {
+        static_assert(idx < sizeof...(pins), "Channel index must be below the number of pins");
+        return channels.get(std::integral_constant<uint8_t, idx>());
+    }
+};
+
+template <int fifo_length = 32, typename encoding_t = PulseEncoding::Wide, typename rt_t, typename... pins>
+inline SharedPulseCounter<rt_t,fifo_length,encoding_t,pins...> sharedPulseCounter(rt_t &rt, pins &... p) {
+    return SharedPulseCounter<rt_t,fifo_length,encoding_t,pins...>(rt, p...);
+}
+
+}
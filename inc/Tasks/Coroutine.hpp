@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Tasks/TaskState.hpp"
+#include "HAL/Atmel/SleepMode.hpp"
+
+/**
+ * Resume point of a stackless, protothread-style coroutine, which lets a task write a sequential
+ * protocol as straight-line code in its loop() method, instead of as an explicit state enum.
+ *
+ *     void loop() {
+ *         AVR_CO_BEGIN(co);
+ *         pin->setLow();
+ *         timeout.schedule(18_ms);
+ *         AVR_CO_AWAIT_DEADLINE(co, timeout, SleepMode::POWER_DOWN);
+ *         pin->configureAsInputWithPullup();
+ *         AVR_CO_AWAIT(co, counter.hasPulses(), SleepMode::IDLE);
+ *         ...
+ *         AVR_CO_END(co);
+ *     }
+ *
+ * Every AVR_CO_ macro expands to a case label of a switch that spans the whole body, so:
+ *   - Local variables are NOT preserved across suspension points. Keep state in fields instead.
+ *   - Locals must not be declared in a scope that a later suspension point is in. Wrap them in { } if needed.
+ *   - At most one suspension point can be on each source line.
+ *   - The enclosing function must return void.
+ *
+ * Call getTaskState() from the task's own getTaskState(), so it reports any deadline
+ * and sleep mode the coroutine is awaiting.
+ */
+class Coroutine {
+public:
+    typedef uint16_t resume_t;
+
+    /** Resume point of a coroutine that will start from the beginning on its next invocation. */
+    static constexpr resume_t START = 0;
+    /** Resume point of a coroutine that has finished, and does nothing until restarted. */
+    static constexpr resume_t DONE = 0xFFFF;
+
+    enum class Awaiting: uint8_t {
+        /** Not suspended, i.e. not started or finished. */
+        NONE,
+        /** Yielded, and wants to resume on the next loop() */
+        NEXT_LOOP,
+        /** Awaiting a deadline */
+        DEADLINE,
+        /** Awaiting a condition that's changed by an interrupt, e.g. a FIFO receiving data. */
+        EVENT
+    };
+
+private:
+    resume_t resumeAt;
+    Awaiting awaiting = Awaiting::NONE;
+    HAL::Atmel::SleepMode sleepMode = HAL::Atmel::SleepMode::POWER_DOWN;
+
+public:
+    /**
+     * Creates a coroutine that starts on its first invocation if [started] is true,
+     * or only after restart() has been called otherwise.
+     */
+    constexpr Coroutine(bool started = true): resumeAt(started ? START : DONE) {}
+
+    /** Makes the coroutine start over from AVR_CO_BEGIN on its next invocation. */
+    void restart() {
+        resumeAt = START;
+        awaiting = Awaiting::NONE;
+    }
+
+    /** Finishes the coroutine, so it does nothing until restarted. */
+    void stop() {
+        resumeAt = DONE;
+        awaiting = Awaiting::NONE;
+    }
+
+    bool isFinished() const {
+        return resumeAt == DONE;
+    }
+
+    Awaiting getAwaiting() const {
+        return awaiting;
+    }
+
+    /**
+     * Returns the task state for this coroutine, where [deadline] is the deadline (or periodic) that
+     * any AVR_CO_AWAIT_DEADLINE in the coroutine was waiting for.
+     */
+    template <typename deadline_t>
+    TaskState getTaskState(const deadline_t &deadline) const {
+        switch (awaiting) {
+        case Awaiting::NEXT_LOOP: return TaskState(some(Milliseconds(0)), sleepMode);
+        case Awaiting::DEADLINE: {
+            const auto t = deadline.timeLeftIfScheduled();
+            return TaskState(t.isDefined() ? t : some(Milliseconds(0)), sleepMode);
+        }
+        case Awaiting::EVENT: return TaskState::busy(sleepMode);
+        default: return (resumeAt == DONE) ? TaskState::idle() : TaskState(some(Milliseconds(0)), sleepMode);
+        }
+    }
+
+    /** Returns the state of a coroutine that doesn't use AVR_CO_AWAIT_DEADLINE */
+    TaskState getTaskState() const {
+        return getTaskState(NoDeadline());
+    }
+
+    // The following are for use by the AVR_CO_ macros only
+
+    resume_t getResumePoint() const {
+        return resumeAt;
+    }
+
+    void suspend(resume_t at, Awaiting a, HAL::Atmel::SleepMode mode) {
+        resumeAt = at;
+        awaiting = a;
+        sleepMode = mode;
+    }
+
+private:
+    struct NoDeadline {
+        Option<Milliseconds> timeLeftIfScheduled() const { return none(); }
+    };
+};
+
+/** Starts the body of a coroutine, resuming at its most recent suspension point. */
+#define AVR_CO_BEGIN(co) switch ((co).getResumePoint()) { case ::Coroutine::START:
+
+/** Ends the body of a coroutine, which then is finished until restarted. */
+#define AVR_CO_END(co) } (co).stop()
+
+/** Returns from the coroutine, which then is finished until restarted. */
+#define AVR_CO_EXIT(co) do { (co).stop(); return; } while (false)
+
+/** Suspends the coroutine until the next invocation, i.e. the next loop() */
+#define AVR_CO_YIELD(co) do { \
+    (co).suspend(__LINE__, ::Coroutine::Awaiting::NEXT_LOOP, ::HAL::Atmel::SleepMode::IDLE); \
+    return; \
+    case __LINE__:; \
+} while (false)
+
+/**
+ * Suspends the coroutine until [condition] is true, which is assumed to be changed by an interrupt
+ * (e.g. counter.hasPulses(), or fifo.hasContent()). The system may sleep in [sleepMode] meanwhile.
+ */
+#define AVR_CO_AWAIT(co, condition, sleepMode) do { \
+    (co).suspend(__LINE__, ::Coroutine::Awaiting::EVENT, sleepMode); \
+    case __LINE__: \
+    if (!(condition)) return; \
+} while (false)
+
+/**
+ * Suspends the coroutine until [deadline] (a Deadline, VariableDeadline or Periodic) is now.
+ * The system may sleep in [sleepMode] meanwhile.
+ */
+#define AVR_CO_AWAIT_DEADLINE(co, deadline, sleepMode) do { \
+    (co).suspend(__LINE__, ::Coroutine::Awaiting::DEADLINE, sleepMode); \
+    case __LINE__: \
+    if (!(deadline).isNow()) return; \
+} while (false)
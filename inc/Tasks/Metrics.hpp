@@ -0,0 +1,167 @@
+#pragma once
+
+#include "gcc_type_traits.h"
+#include "AtomicScope.hpp"
+#include "Streams/Protobuf.hpp"
+#include "Streams/Nested.hpp"
+#include "Time/RealTimer.hpp"
+#include "Tasks/TaskState.hpp"
+
+/**
+ * Runtime counters and gauges of drivers, periodically sent out as a single protobuf message, e.g.
+ *
+ *     auto metrics = metricsReporter(rt, 5_min,
+ *         [this] (auto msg) { return rfm.write_fsk(HopeRF::Headers::METRICS, msg); },
+ *         Metrics::counter<1>([this] { return rfm.getRecvCount(); }),
+ *         Metrics::counter<2>([this] { return rfm.getUnderruns(); }),
+ *         Metrics::counter<3>([this] { return pulseCounter.getOverflows(); }),
+ *         Metrics::gauge<4>([] { return HAL::Atmel::stackHighWater(); }));
+ *
+ * The numbers are the protobuf field indexes to report each metric under.
+ */
+namespace Metrics {
+
+namespace Impl {
+
+enum class Kind: uint8_t { COUNTER, GAUGE };
+
+template <Kind kind, uint8_t fieldIdx, typename read_t>
+class Metric {
+    typedef typename std::decay<decltype(std::declval<read_t&>()())>::type value_t;
+    static_assert(std::is_unsigned<value_t>::value, "Metrics must be unsigned integers");
+
+    read_t read;
+    value_t sent = 0;
+    value_t pending = 0;
+
+public:
+    constexpr Metric(read_t r): read(r) {}
+
+    /** Takes a new sample, and returns whether it differs from the one that was last reported. */
+    bool sample() {
+        pending = read();
+        return pending != sent;
+    }
+
+    /**
+     * Writes a counter as the increment since it was last reported (wrapping around at the counter's own size),
+     * and a gauge as its current value. Nothing is written if the metric hasn't changed.
+     */
+    template <typename write_t>
+    bool write(write_t &write) const {
+        if (pending == sent) {
+            return true;
+        }
+        const uint32_t value = (kind == Kind::COUNTER) ? value_t(pending - sent) : pending;
+        return write(Streams::Protobuf::Varint<uint32_t, fieldIdx>(value));
+    }
+
+    /** Marks the sample as reported, after it's been successfully sent. */
+    void commit() {
+        sent = pending;
+    }
+};
+
+template <typename... metrics>
+struct Registry {
+    bool sample() { return false; }
+
+    template <typename write_t>
+    bool write(write_t &write) const { return true; }
+
+    void commit() {}
+};
+
+template <typename head, typename... tail>
+struct Registry<head, tail...> {
+    head metric;
+    Registry<tail...> next;
+
+    Registry(head h, tail... t): metric(h), next(t...) {}
+
+    bool sample() {
+        const bool changed = metric.sample();
+        return next.sample() || changed;
+    }
+
+    template <typename write_t>
+    bool write(write_t &write) const {
+        return metric.write(write) && next.write(write);
+    }
+
+    void commit() {
+        metric.commit();
+        next.commit();
+    }
+};
+
+} // namespace Impl
+
+/** A metric that only goes up, e.g. received packets, reported as its increase since the previous report. */
+template <uint8_t fieldIdx, typename read_t>
+Impl::Metric<Impl::Kind::COUNTER, fieldIdx, read_t> counter(read_t read) {
+    return read;
+}
+
+/** A metric that goes up and down, e.g. free memory, reported as its current value when it has changed. */
+template <uint8_t fieldIdx, typename read_t>
+Impl::Metric<Impl::Kind::GAUGE, fieldIdx, read_t> gauge(read_t read) {
+    return read;
+}
+
+} // namespace Metrics
+
+/**
+ * Task that periodically samples all [metrics], and sends the ones that changed since the last report as a
+ * protobuf message, by invoking [send] with a Streams::Nested that writes the message. [send] returns whether it
+ * could write the message, e.g. using RFM12::write_fsk or a UART's write. If it couldn't, the changes are kept,
+ * and included in the next report. No message is sent if nothing changed at all.
+ */
+template <typename rt_t, typename value_t, typename send_t, typename... metrics>
+class MetricsReporter {
+    typedef MetricsReporter<rt_t, value_t, send_t, metrics...> This;
+
+    Periodic<rt_t, value_t> every;
+    send_t send;
+    Metrics::Impl::Registry<metrics...> registry;
+
+public:
+    /** Only needs its loop() invoked when the periodic has elapsed */
+    typedef HAL::Atmel::InterruptHandlers::NoHandlers<This> WakeOn;
+
+    MetricsReporter(rt_t &rt, send_t s, metrics... m): every(rt), send(s), registry(m...) {}
+
+    /** Samples and sends the metrics right away. Returns false if [send] couldn't write the message. */
+    bool report() {
+        bool changed;
+        {
+            AtomicScope _;
+            changed = registry.sample();
+        }
+        if (!changed) {
+            return true;
+        }
+        const auto *r = &registry;
+        if (send(Streams::Nested([r] (auto write) { return r->write(write); }))) {
+            registry.commit();
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    TaskState getTaskState() const {
+        return TaskState(every.timeLeftIfScheduled(), HAL::Atmel::SleepMode::POWER_DOWN);
+    }
+
+    void loop() {
+        if (every.isNow()) {
+            report();
+        }
+    }
+};
+
+template <typename rt_t, typename value_t, typename send_t, typename... metrics>
+MetricsReporter<rt_t, value_t, send_t, metrics...> metricsReporter(rt_t &rt, value_t interval, send_t send, metrics... m) {
+    return MetricsReporter<rt_t, value_t, send_t, metrics...>(rt, send, m...);
+}
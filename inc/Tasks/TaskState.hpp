@@ -10,6 +10,9 @@ using namespace Time;
 class TaskState {
 	Option<Milliseconds> tLeft;
 	HAL::Atmel::SleepMode maxSleepMode;
+	uint16_t slack;
+
+	constexpr TaskState(Option<Milliseconds> t, HAL::Atmel::SleepMode s, uint16_t _slack): tLeft(t), maxSleepMode(s), slack(_slack) {}
 public:
 	/**
 	 * Returns the deepest sleep mode this task can allow the system to go into, when the task
@@ -17,9 +20,9 @@ public:
 	 */
 	HAL::Atmel::SleepMode getMaxSleepMode() const { return maxSleepMode; }
 
-	constexpr TaskState(): tLeft(none()), maxSleepMode(HAL::Atmel::SleepMode::POWER_DOWN) {}
+	constexpr TaskState(): tLeft(none()), maxSleepMode(HAL::Atmel::SleepMode::POWER_DOWN), slack(0) {}
 
-	constexpr TaskState(Option<Milliseconds> t, HAL::Atmel::SleepMode s): tLeft(t), maxSleepMode(s) {}
+	constexpr TaskState(Option<Milliseconds> t, HAL::Atmel::SleepMode s): tLeft(t), maxSleepMode(s), slack(0) {}
 
 	/**
 	 * Returns a TaskState indicating a task, which expects a periodic or deadline to fire after [time], and
@@ -58,4 +61,29 @@ public:
 	 * a reasonable timeout.
 	 */
 	constexpr Milliseconds timeLeft() const { return tLeft.get(); }
+
+	/**
+	 * Returns a copy of this TaskState that allows its deadline to be postponed by up to [time] (at most 65535ms).
+	 * This allows the system to combine nearby deadlines of several tasks into a single wake-up.
+	 */
+	template <typename time_t>
+	constexpr TaskState withSlack(time_t time) const {
+		const Milliseconds t = time.toMillis();
+		return { tLeft, maxSleepMode, (t.getValue() > 0xFFFF) ? uint16_t(0xFFFF) : uint16_t(t.getValue()) };
+	}
+
+	/**
+	 * Returns by how much this task's deadline may be postponed.
+	 */
+	constexpr Milliseconds getSlack() const { return slack; }
+
+	/**
+	 * For non-idle tasks, returns the latest time at which the task still wants the system to wake up,
+	 * i.e. timeLeft() + getSlack(). Tasks that are already due get no slack, since they're being handled
+	 * by the current loop iteration, and should report a fresh state on the next one.
+	 */
+	constexpr Milliseconds latestWakeup() const {
+		return (tLeft.get().getValue() == 0) ? 0 :
+		       (tLeft.get().getValue() > 0xFFFFFFFF - slack) ? 0xFFFFFFFF : tLeft.get().getValue() + slack;
+	}
 };
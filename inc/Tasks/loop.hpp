@@ -3,6 +3,8 @@
 #include "gcc_type_traits.h"
 #include <stdint.h>
 #include "Tasks/TaskState.hpp"
+#include "AtomicScope.hpp"
+#include "Logging.hpp"
 
 using namespace Time;
 
@@ -22,6 +24,108 @@ public:
 };
 
 
+/**
+ * A task is event-driven if it declares a typedef "WakeOn", aliasing a handler chain (e.g. its own Handlers, or those
+ * of the driver it reads from). Its loop() is then only invoked when any of those handlers has fired, or when
+ * its own deadline has passed. Only handlers of classes for which InterruptHandlers::WakesTasks is specialized
+ * record that they have fired.
+ */
+template<typename T>
+struct is_event_driven
+{
+private:
+    typedef std::true_type yes;
+    typedef std::false_type no;
+
+    template<typename U> static auto test(int) -> decltype(std::declval<typename U::WakeOn>(), yes());
+    template<typename> static no test(...);
+public:
+    static constexpr bool value = std::is_same<decltype(test<T>(0)),yes>::value;
+};
+
+/** Accumulated TCNT1 counts spent in one kind of task method */
+struct TaskTiming {
+    uint32_t total;
+    uint16_t max;
+    uint16_t count;
+
+    void add(uint16_t duration) {
+        // Stop once saturated, so total/count remains the mean of the samples taken.
+        if (count == 0xFFFF) {
+            return;
+        }
+        total += duration;
+        if (duration > max) {
+            max = duration;
+        }
+        count++;
+    }
+};
+
+struct TaskProfile {
+    TaskTiming getTaskState;
+    TaskTiming loop;
+};
+
+constexpr uint8_t maxProfiledTasks = 16;
+
+/**
+ * Per-task profiling of loopTasks(), enabled by turning on timing for Loggers::Tasks in LoggingSettings.hpp.
+ * Samples TCNT1 like Logging::TimingEnabled, so timer 1 must be running (with prescaler 1 to measure cycles), and
+ * individual samples are limited to 65535 counts. When disabled, this compiles to nothing.
+ */
+template <bool enabled = Logging::Log<Loggers::Tasks>::isTimingEnabled()>
+struct TaskProfiler {
+    static TaskProfile profiles[maxProfiledTasks];
+    static uint16_t startTime;
+
+    __attribute__((always_inline)) inline static void timeStart() {
+        startTime = HAL::Atmel::Registers::TCNT1.get();
+    }
+
+    __attribute__((always_inline)) inline static void timeTaskState(uint8_t slot) {
+        profiles[slot].getTaskState.add(HAL::Atmel::Registers::TCNT1.get() - startTime);
+    }
+
+    __attribute__((always_inline)) inline static void timeLoop(uint8_t slot) {
+        profiles[slot].loop.add(HAL::Atmel::Registers::TCNT1.get() - startTime);
+    }
+
+    static void clear() {
+        for (uint8_t i = 0; i < maxProfiledTasks; i++) {
+            profiles[i] = {};
+        }
+    }
+
+    static void print() {
+        using Streams::dec;
+        typedef Logging::Log<Loggers::Tasks> log;
+        for (uint8_t i = 0; i < maxProfiledTasks; i++) {
+            const TaskProfile &p = profiles[i];
+            if (p.getTaskState.count > 0) {
+                log::debug(F("T"), dec(i),
+                           F(" s:"), dec(p.getTaskState.count), '/', dec(p.getTaskState.total), '/', dec(p.getTaskState.max),
+                           F(" l:"), dec(p.loop.count), '/', dec(p.loop.total), '/', dec(p.loop.max));
+            }
+        }
+    }
+};
+
+template <bool enabled>
+TaskProfile TaskProfiler<enabled>::profiles[maxProfiledTasks];
+
+template <bool enabled>
+uint16_t TaskProfiler<enabled>::startTime;
+
+template <>
+struct TaskProfiler<false> {
+    inline static void timeStart() {}
+    inline static void timeTaskState(uint8_t slot) {}
+    inline static void timeLoop(uint8_t slot) {}
+    inline static void clear() {}
+    inline static void print() {}
+};
+
 template <typename T>
 void invokeIfHasLoop(T &t, std::true_type) {
     t.loop();
@@ -30,13 +134,138 @@ void invokeIfHasLoop(T &t, std::true_type) {
 template <typename T>
 void invokeIfHasLoop(T &t, std::false_type) {}
 
+template <typename T>
+bool needsLoop(const TaskState &state, std::true_type) {
+    static_assert(!T::WakeOn::hasHandlers() || T::WakeOn::hasWakeFlags(),
+                  "None of the handlers in WakeOn set a wake flag. Specialize InterruptHandlers::WakesTasks for their class.");
+    return T::WakeOn::isWakePending() || (!state.isIdle() && state.timeLeft().getValue() == 0);
+}
+
+template <typename T>
+bool needsLoop(const TaskState &state, std::false_type) {
+    return true;
+}
+
+template <typename T>
+void clearWakeFlags(std::true_type) {
+    T::WakeOn::clearWakeFlags();
+}
+
+template <typename T>
+void clearWakeFlags(std::false_type) {}
+
+/** Bit mask with one bit for each of N tasks */
+template <uint8_t N>
+using TaskMask = typename std::conditional<(N <= 8), uint8_t,
+                 typename std::conditional<(N <= 16), uint16_t, uint32_t>::type>::type;
+
+/** Sort key for earliest-deadline-first ordering, where idle tasks come last. */
+inline uint32_t urgency(const TaskState &state) {
+    return state.isIdle() ? 0xFFFFFFFF : state.timeLeft().getValue();
+}
+
+/**
+ * Insertion sorting network over the task slots in order[0..n), by ascending urgency of their states. Comparators
+ * only swap on strictly larger keys, so tasks with equal deadlines keep their argument order.
+ */
+template <uint8_t n>
+struct DeadlineSort {
+    template <uint8_t i>
+    static void compareExchange(uint8_t *order, const TaskState *states) {
+        if (urgency(states[order[i]]) > urgency(states[order[i + 1]])) {
+            const uint8_t tmp = order[i];
+            order[i] = order[i + 1];
+            order[i + 1] = tmp;
+        }
+    }
+
+    /** Moves order[i] down into the sorted order[0..i) */
+    template <uint8_t i>
+    static void insert(uint8_t *order, const TaskState *states, std::true_type) {
+        compareExchange<i - 1>(order, states);
+        insert<i - 1>(order, states, std::integral_constant<bool, (i > 1)>());
+    }
+
+    template <uint8_t i>
+    static void insert(uint8_t *order, const TaskState *states, std::false_type) {}
+
+    static void sort(uint8_t *order, const TaskState *states) {
+        DeadlineSort<n - 1>::sort(order, states);
+        insert<n - 1>(order, states, std::true_type());
+    }
+};
+
+template <>
+struct DeadlineSort<1> {
+    static void sort(uint8_t *order, const TaskState *states) {}
+};
+
+/** A budget that never runs out */
+struct NoBudget {
+    void start() {}
+    bool isExhausted() const { return false; }
+    void defer(uint32_t mask) {}
+    uint32_t takeDeferred() { return 0; }
+};
+
+/**
+ * Limits the time spent invoking loop() methods in a single loopTasksByDeadline() iteration. Any task that
+ * has not been invoked once the budget is used up is deferred to the next iteration, which then doesn't sleep.
+ */
+template <typename rt_t>
+class TaskBudget {
+    rt_t *rt;
+    uint32_t budget;
+    uint32_t startTime = 0;
+    uint32_t deferred = 0;
+public:
+    TaskBudget(rt_t &_rt, uint32_t counts): rt(&_rt), budget(counts) {}
+
+    void start() {
+        startTime = rt->counts();
+    }
+
+    bool isExhausted() const {
+        return rt->counts() - startTime >= budget;
+    }
+
+    void defer(uint32_t mask) {
+        deferred |= mask;
+    }
+
+    uint32_t takeDeferred() {
+        const uint32_t result = deferred;
+        deferred = 0;
+        return result;
+    }
+
+    /** Returns whether any tasks were deferred to the next iteration */
+    bool hasDeferred() const {
+        return deferred != 0;
+    }
+};
+
 template <typename power_t, typename... types_t>
 struct MultiLoop {
-    static void setTaskStates(TaskState *dest) {
+    static void setTaskStates(uint8_t slot, TaskState *dest) {
         // nothing for zero args
     }
 
-    static void invokeLoop(types_t &... args) {
+    template <typename mask_t>
+    static mask_t getDirtyTasks(const TaskState *states) {
+        return 0;
+    }
+
+    static void clearWakeFlags() {
+        // nothing for zero args
+    }
+
+    template <typename mask_t>
+    static void invokeLoop(uint8_t slot, mask_t dirty, types_t &... args) {
+        // nothing for zero args
+    }
+
+    static void invokeSlot(uint8_t slot, uint8_t target, types_t &... args) {
         // nothing for zero args
     }
 };
@@ -45,21 +274,105 @@ template <typename power_t, typename head_t, typename... tail_t>
 struct MultiLoop<power_t, head_t, tail_t...> {
     typedef MultiLoop<power_t, tail_t...> Tail;
     static constexpr uint8_t N = sizeof...(tail_t) + 1;
+    static_assert(N <= 32, "loopTasks() supports at most 32 tasks");
+    typedef std::integral_constant<bool, is_event_driven<head_t>::value> eventDriven;
+    typedef TaskProfiler<> profiler;
 
-    static void setTaskStates(TaskState *dest, head_t &head, tail_t &... tail) {
+    static void setTaskStates(uint8_t slot, TaskState *dest, head_t &head, tail_t &... tail) {
+        profiler::timeStart();
         *dest = head.getTaskState();
-        Tail::setTaskStates(dest + 1, tail...);
+        profiler::timeTaskState(slot);
+        Tail::setTaskStates(slot + 1, dest + 1, tail...);
+    }
+
+    /**
+     * Returns a bit mask of the tasks (bit 0 being the head) whose loop() should be invoked in this iteration.
+     */
+    template <typename mask_t>
+    static mask_t getDirtyTasks(const TaskState *states) {
+        const mask_t tail = Tail::template getDirtyTasks<mask_t>(states + 1) << 1;
+        return needsLoop<head_t>(*states, eventDriven()) ? (tail | 1) : tail;
+    }
+
+    static void clearWakeFlags() {
+        TasksImpl::clearWakeFlags<head_t>(eventDriven());
+        Tail::clearWakeFlags();
+    }
+
+    template <typename mask_t>
+    static void invokeLoop(uint8_t slot, mask_t dirty, head_t &head, tail_t &...tail) {
+        if (dirty & 1) {
+            profiler::timeStart();
+            invokeIfHasLoop(head, std::integral_constant<bool, has_loop_method<head_t>::value>());
+            profiler::timeLoop(slot);
+        }
+        Tail::invokeLoop(slot + 1, mask_t(dirty >> 1), tail...);
     }
 
-    static void invokeLoop(head_t &head, tail_t &...tail) {
-        invokeIfHasLoop(head, std::integral_constant<bool, has_loop_method<head_t>::value>());
-        Tail::invokeLoop(tail...);
+    /** Invokes loop() on the task with the given target slot only */
+    static void invokeSlot(uint8_t slot, uint8_t target, head_t &head, tail_t &...tail) {
+        if (slot == target) {
+            profiler::timeStart();
+            invokeIfHasLoop(head, std::integral_constant<bool, has_loop_method<head_t>::value>());
+            profiler::timeLoop(slot);
+        } else {
+            Tail::invokeSlot(slot + 1, target, tail...);
+        }
+    }
+
+    template <typename budget_t>
+    static void loopByDeadline(power_t &power, budget_t &budget, head_t &head, tail_t &...tail) {
+        static_assert(!Logging::Log<Loggers::Tasks>::isTimingEnabled() || N <= maxProfiledTasks,
+                "Too many tasks to profile, increase maxProfiledTasks");
+        TaskState states[N];
+        setTaskStates(0, states, head, tail...);
+        TaskMask<N> dirty;
+        {
+            AtomicScope _;
+            dirty = getDirtyTasks<TaskMask<N>>(states) | TaskMask<N>(budget.takeDeferred());
+            clearWakeFlags();
+        }
+        uint8_t order[N];
+        for (uint8_t i = 0; i < N; i++) {
+            order[i] = i;
+        }
+        DeadlineSort<N>::sort(order, states);
+
+        bool invoked = false;
+        bool deferred = false;
+        budget.start();
+        for (uint8_t i = 0; i < N; i++) {
+            const uint8_t slot = order[i];
+            const TaskMask<N> bit = TaskMask<N>(1) << slot;
+            if (dirty & bit) {
+                // the most urgent task always runs, even if the budget is smaller than the time to get here
+                if (invoked && budget.isExhausted()) {
+                    budget.defer(bit);
+                    deferred = true;
+                } else {
+                    invokeSlot(0, slot, head, tail...);
+                    invoked = true;
+                }
+            }
+        }
+        if (!deferred) {
+            power.sleepUntilTasks(states, N);
+        }
     }
 
     static void loop(power_t &power, head_t &head, tail_t &...tail) {
+        static_assert(!Logging::Log<Loggers::Tasks>::isTimingEnabled() || N <= maxProfiledTasks,
+                "Too many tasks to profile, increase maxProfiledTasks");
         TaskState states[N];
-        setTaskStates(states, head, tail...);
-        invokeLoop(head, tail...);
+        setTaskStates(0, states, head, tail...);
+        TaskMask<N> dirty;
+        {
+            // Several tasks can be woken by the same handlers, so only clear them after having checked all tasks.
+            AtomicScope _;
+            dirty = getDirtyTasks<TaskMask<N>>(states);
+            clearWakeFlags();
+        }
+        invokeLoop(0, dirty, head, tail...);
         power.sleepUntilTasks(states, N);
     }
 };
@@ -69,10 +382,56 @@ struct MultiLoop<power_t, head_t, tail_t...> {
 /**
  * Automatically generates and invokes a "super-loop" function that does the following:
  * - Invokes getTaskState() on all of the arguments (expecting each to return a TaskState instance)
- * - Invokes loop() on all arguments, in sequence
+ * - Invokes loop() on all arguments, in sequence. Event-driven tasks (those declaring a WakeOn typedef,
+ *   see TasksImpl::is_event_driven) are skipped unless any of their WakeOn handlers has fired since the
+ *   previous iteration, or their deadline has passed.
  * - Sleeps for the lowest duration, and deepest allowed sleep state, according to the earlier-gathered task states.
  */
 template <typename power_t, typename... types_t>
 void loopTasks(power_t &power, types_t &... args) {
     TasksImpl::MultiLoop<power_t, types_t...>::loop(power, args...);
 }
+
+/**
+ * Like loopTasks(), but invokes loop() on the tasks in earliest-deadline-first order, i.e. by ascending
+ * TaskState::timeLeft(), with idle tasks last. Tasks with equal deadlines are invoked in argument order.
+ */
+template <typename power_t, typename... types_t>
+void loopTasksByDeadline(power_t &power, types_t &... args) {
+    TasksImpl::NoBudget budget;
+    TasksImpl::MultiLoop<power_t, types_t...>::loopByDeadline(power, budget, args...);
+}
+
+/**
+ * Like loopTasks(), but invokes loop() on the tasks in earliest-deadline-first order, and stops invoking tasks
+ * once [budget] has elapsed. Any remaining tasks are invoked in the next iteration, which again runs in deadline
+ * order, and the system won't sleep in between. The most urgent task is always invoked.
+ */
+template <typename power_t, typename rt_t, typename... types_t>
+void loopTasksByDeadline(power_t &power, TasksImpl::TaskBudget<rt_t> &budget, types_t &... args) {
+    TasksImpl::MultiLoop<power_t, types_t...>::loopByDeadline(power, budget, args...);
+}
+
+/**
+ * Returns a time budget for use with loopTasksByDeadline(), measured on the given real timer.
+ */
+template <typename rt_t, typename duration_t>
+TasksImpl::TaskBudget<rt_t> taskBudget(rt_t &rt, const duration_t duration) {
+    return { rt, uint32_t(toCountsOn<rt_t>(duration).getValue()) };
+}
+
+/**
+ * Logs, through Loggers::Tasks, the number of invocations, and total and maximum TCNT1 counts spent in getTaskState()
+ * and loop() of each task slot (in the order they're passed to loopTasks). Only available when timing is enabled
+ * for Loggers::Tasks.
+ */
+inline void printTaskProfile() {
+    TasksImpl::TaskProfiler<>::print();
+}
+
+/**
+ * Resets all accumulated task profiling information.
+ */
+inline void clearTaskProfile() {
+    TasksImpl::TaskProfiler<>::clear();
+}
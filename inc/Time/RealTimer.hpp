@@ -17,7 +17,7 @@
 #include <gcc_limits.h>
 #include <gcc_type_traits.h>
 
-namespace HAL { namespace Atmel { namespace Impl { template <typename> class Power; }}}
+namespace HAL { namespace Atmel { namespace Impl { template <typename, bool> class Power; }}}
 
 namespace Time {
 
@@ -38,11 +38,16 @@ struct Overflow {
 using namespace HAL::Atmel::InterruptHandlers;
 using HAL::Atmel::SleepMode;
 
-template<typename timer_t, uint32_t initialTicks = 0, void (*wait)() = Impl::noop>
-class RealTimer: public Time::Prescaled<typename timer_t::value_t, typename timer_t::prescaler_t, timer_t::prescaler> {
-    typedef RealTimer<timer_t,initialTicks,wait> This;
+template<typename _timer_t, uint32_t initialTicks = 0, void (*wait)() = Impl::noop>
+class RealTimer: public Time::Prescaled<typename _timer_t::value_t, typename _timer_t::prescaler_t, _timer_t::prescaler> {
+    typedef RealTimer<_timer_t,initialTicks,wait> This;
+
+    template <typename, bool> friend class HAL::Atmel::Impl::Power;
 
-    template <typename> friend class HAL::Atmel::Impl::Power;
+public:
+    typedef _timer_t timer_t;
+
+private:
 
     volatile uint32_t _ticks = initialTicks;
     timer_t *timer;
@@ -51,6 +56,21 @@ class RealTimer: public Time::Prescaled<typename timer_t::value_t, typename time
        _ticks++;
     }
 
+    /**
+     * Returns the number of timer overflows, including one that has happened but whose interrupt hasn't run yet
+     * (e.g. because we're inside another interrupt handler), together with the timer [value] that goes with it.
+     * Must be invoked with interrupts disabled.
+     */
+    uint32_t currentTicks(typename timer_t::value_t &value) const {
+        uint32_t t = _ticks;
+        value = timer->getValue();
+        // If the timer is at its maximum, the overflow may have happened after reading it.
+        if (timer->isOverflow() && value < timer_t::maximum) {
+            t++;
+        }
+        return t;
+    }
+
     template <typename time_t>
     void haveSlept(time_t time) {
         uint32_t delta = toTicksOn<This>(time).getValue();
@@ -105,38 +125,45 @@ public:
     }
 
     /**
-     * Returns a 32-bit value that increments with every timer increment.
+     * Returns a 32-bit value that increments with every timer increment. This is also correct inside other
+     * interrupt handlers, when the timer has just overflowed but its interrupt hasn't run yet.
      */
     Counts counts() const {
         AtomicScope _;
-        return (_ticks << timer_t::maximumPower2) | timer->getValue();
+        typename timer_t::value_t value;
+        const uint32_t t = currentTicks(value);
+        return (t << timer_t::maximumPower2) | value;
     }
 
     Microseconds micros() const {
         AtomicScope _;
+        typename timer_t::value_t value;
+        const uint32_t t = currentTicks(value);
 
 #if F_CPU != 16000000
 #error This function assumes 16MHz clock. Please make the function smarter if running with different clock.
 #endif
-        // shift left to multiply ticks by the prescaler value
+        // times 256 ( << 8) to go from timer overflows to timer counts (8 bit timer overflows at 256)
+        // shift left to multiply counts by the prescaler value
         // divide by 16 ( >> 4) to go from clock ticks to microseconds
-        // times 256 ( << 8) to go from clock  ticks to timer overflow (8 bit timer overflows at 256)
 
-        return (((((uint64_t)_ticks) << timer_t::prescalerPower2) + timer->getValue()) / 16) << timer_t::maximumPower2;
+        return (((((uint64_t)t) << timer_t::maximumPower2) + value) << timer_t::prescalerPower2) / 16;
     }
 
     Milliseconds millis() const {
         AtomicScope _;
+        typename timer_t::value_t value;
+        const uint32_t t = currentTicks(value);
 
 #if F_CPU != 16000000
 #error This function assumes 16MHz clock. Please make the function smarter if running with different clock.
 #endif
-        // shift left to multiply ticks by the prescaler value
+        // times 256 ( << 8) to go from timer overflows to timer counts (8 bit timer overflows at 256)
+        // shift left to multiply counts by the prescaler value
         // divide by 16 ( >> 4) to go from clock ticks to microseconds
-        // times 256 ( << 8) to go from clock  ticks to timer overflow (8 bit timer overflows at 256)
         // divide by 1000 to get milliseconds
 
-        return ((((((uint64_t)_ticks) << timer_t::prescalerPower2) + timer->getValue()) / 16) << timer_t::maximumPower2) / 1000;
+        return (((((uint64_t)t) << timer_t::maximumPower2) + value) << timer_t::prescalerPower2) / 16 / 1000;
     }
 
     template <typename duration_t>
@@ -160,6 +187,9 @@ struct TimedTask {
     timed_t * const timed;
     T * const target;
 public:
+    /** Only needs its loop() invoked when the timed_t has elapsed */
+    typedef NoHandlers<TimedTask<timed_t,T,handler>> WakeOn;
+
     TaskState getTaskState() const {
         return TaskState(timed->timeLeftIfScheduled(), SleepMode::POWER_DOWN);
     }
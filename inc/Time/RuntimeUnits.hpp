@@ -77,6 +77,9 @@ public:
 class Ticks: public RuntimeTimeUnit<Ticks> {
     using RuntimeTimeUnit<Ticks>::RuntimeTimeUnit;
 public:
+    template <typename prescaled_t>
+    constexpr Ticks toTicksOn() const { return *this; }
+
     template <typename prescaled_t>
     constexpr Milliseconds toMillisOn() const;
 
@@ -185,6 +185,15 @@ private:
     static constexpr count_t us_1000  = toCountsOn<comparator_t>(1000_us).getValue();
 
 public:
+    /** Pulses outside of [minPulse, maxPulse] are never part of a bit, so they leave an idle decoder idle. */
+    static constexpr count_t minPulse = us_200 + 1;
+    static constexpr count_t maxPulse = us_1000 - 1;
+
+    /** Returns whether the decoder hasn't seen any bits of a packet, i.e. any stray pulse only resets it. */
+    bool isIdle() const {
+        return state == State::UNKNOWN && pos == 0 && bit == 0 && !haveFlipped;
+    }
+
     void apply(const Pulse &pulse) {
         if (pulse.isDefined()) {
             // TODO investigate whether these are actually LOw or HIGH
@@ -4,12 +4,13 @@
 using namespace HAL::Atmel;
 
 Impl::BaseADC::BaseADC() {
+    enable();
 	REFS0.set();   // Set ADC reference to AVCC
 	ADIE.set();    // Enable ADC Interrupt
-    enable();
 }
 
 void Impl::BaseADC::enable() {
+	PRADC.clear(); // Start the ADC clock, in case it was powered down
 	ADEN.set(); // Enable ADC
 }
 
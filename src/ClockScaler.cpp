@@ -0,0 +1,25 @@
+#include "HAL/Atmel/ClockScaler.hpp"
+
+using namespace HAL::Atmel::Registers;
+
+void HAL::Atmel::Impl::setClockDivider(uint8_t power2) {
+#ifdef AVR
+    // The new value must be written within 4 cycles of setting CLKPCE, so both stores are done in assembly
+    // (as avr-libc's clock_prescale_set does), with interrupts disabled in between.
+    uint8_t sreg;
+    __asm__ __volatile__ (
+        "in %[sreg], __SREG__" "\n\t"
+        "cli" "\n\t"
+        "sts %[clkpr], %[enable]" "\n\t"
+        "sts %[clkpr], %[value]" "\n\t"
+        "out __SREG__, %[sreg]" "\n\t"
+        : [sreg] "=&r" (sreg)
+        : [clkpr] "n" (CLKPR_t::address),
+          [enable] "r" (uint8_t(0x80)),
+          [value] "r" (power2)
+        : "memory");
+#else
+    CLKPR = CLKPCE;
+    CLKPR.set(power2);
+#endif
+}
@@ -17,3 +17,24 @@ uint8_t FS20Packet::getExpectedChecksum() const {
 bool FS20Packet::isChecksumCorrect() const {
     return checksum == getExpectedChecksum();
 }
+
+uint8_t FS20Format::packetBytes(const uint8_t *data, uint8_t bytes) {
+    return (bytes < 4 || (data[3] & (1 << 5)) != 0) ? 6 : 5;
+}
+
+bool FS20Format::isValid(const uint8_t *data, uint8_t bytes) {
+    return toPacket(data, bytes).isChecksumCorrect();
+}
+
+FS20Packet FS20Format::toPacket(const uint8_t *data, uint8_t bytes) {
+    FS20Packet packet;
+    packet.houseCodeHi = data[0];
+    packet.houseCodeLo = data[1];
+    packet.address = data[2];
+    packet.command = data[3];
+    if (bytes > 5) {
+        packet.commandExt = data[4];
+    }
+    packet.checksum = data[bytes - 1];
+    return packet;
+}
@@ -2,6 +2,6 @@
 
 using namespace FS20;
 
-const uint8_t FS20Packet::prefix[] = { 0b00000000, 0b00000000, 0b10000000 };
+constexpr uint8_t FS20Packet::prefix[];
 
-const uint8_t FS20Packet::postfix[] = { 0b00, };
+constexpr uint8_t FS20Packet::postfix[];
@@ -1,14 +1,34 @@
 #include "Logging.hpp"
 
-volatile uint16_t debugTimings[debugTimingMax];
-volatile uint8_t debugTimingsCount = 0;
-
 volatile uint16_t pls = 0;
 
+Logging::Impl::EventRing<Logging::Impl::eventRingSize> Logging::Impl::events;
+
 #ifndef AVR
+#include <vector>
+
 namespace Logging {
 namespace Impl {
 std::mutex logging_mutex;
+
+static std::vector<const char *> binaryStrings;
+
+uint16_t binaryId(const char *str) {
+    std::lock_guard<std::mutex> lock(logging_mutex);
+    for (uint16_t i = 0; i < binaryStrings.size(); i++) {
+        if (binaryStrings[i] == str) {
+            return i + 1;
+        }
+    }
+    binaryStrings.push_back(str);
+    return binaryStrings.size();
+}
+
+const char *binaryString(uint16_t id) {
+    std::lock_guard<std::mutex> lock(logging_mutex);
+    return (id > 0 && id <= binaryStrings.size()) ? binaryStrings[id - 1] : nullptr;
+}
+
 }
 }
 #endif
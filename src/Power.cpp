@@ -1,4 +1,5 @@
 #include "HAL/Atmel/Power.hpp"
+#include "HAL/Atmel/TWI.hpp"
 
 using namespace HAL::Atmel;
 using namespace HAL::Atmel::Registers;
@@ -17,6 +18,10 @@ INLINE static void sleep_cpu() {
 }
 #endif
 
+/**
+ * Timed sequence to turn off the brown-out detector during the next sleep. The sleep instruction must
+ * follow within 3 cycles.
+ */
 INLINE static void sleep_bod_disable() {
     MCUCR_t tmp;
     tmp |= (BODS | BODSE);
@@ -25,9 +30,29 @@ INLINE static void sleep_bod_disable() {
     MCUCR = tmp;
 }
 
+/**
+ * Returns whether the TWI is enabled, but not in the middle of a transaction. The status register can't tell
+ * (it reads TW_NO_INFO while a byte is on the wire), so this relies on the driver's transceiving flag.
+ */
+INLINE static bool isTWIIdle() {
+    return TWEN.isSet() && TWSTO.isCleared() && !Impl::TWIBus::transceiving;
+}
+
 void HAL::Atmel::Impl::sleep(SleepMode mode) {
-  auto adcsraSave = ADCSRA.get();
-    ADEN.clear(); // disable the ADC
+    const auto adcsraSave = ADCSRA.get();
+    const auto twcrSave = TWCR.get();
+    const auto prrSave = PRR.get();
+
+    const bool adcIdle = ADSC.isCleared();
+    if (adcIdle) {
+        ADEN.clear(); // the ADC must be disabled before stopping its clock
+        PRADC.set();
+    }
+    const bool twiIdle = isTWIIdle();
+    if (twiIdle) {
+        PRTWI.set();
+    }
+
     switch(mode) {
     case SleepMode::POWER_DOWN:
         SMCR.apply(~SM0 | SM1 | ~SM2); break;
@@ -37,12 +62,20 @@ void HAL::Atmel::Impl::sleep(SleepMode mode) {
         SMCR.apply(~SM0 | ~SM1 | ~SM2); break;
     }
 
-    {
-        AtomicScope::SEI _;
-        SE.set(); // sleep enable
+    cli();
+    SE.set(); // sleep enable
+    if (mode == SleepMode::POWER_DOWN) {
         sleep_bod_disable();
     }
+    sei(); // the instruction after sei is executed before any pending interrupt
     sleep_cpu();
     SE.clear(); // sleep disable
-    ADCSRA.set(adcsraSave);
+
+    PRR.set(prrSave);
+    if (adcIdle) {
+        ADCSRA.set(adcsraSave);
+    }
+    if (twiIdle) {
+        TWCR.set(twcrSave); // re-initialize the TWI after its clock has been stopped
+    }
 }
@@ -1,9 +1,10 @@
 #include "Serial/RS232.hpp"
+#include "Serial/RS232Tx.hpp"
 
 using namespace Serial;
 
-// Start bit is always low
-const uint8_t RS232::prefix[] = { 0b0 };
+constexpr uint8_t RS232::prefix[];
 
-// Stop bit(s) are always high
-const uint8_t RS232::postfix[] = { 0b11 };
+constexpr uint8_t RS232::postfix[];
+
+const Serial::Impl::RS232TxRuns Serial::Impl::rs232TxRuns PROGMEM = Serial::Impl::RS232TxRuns();
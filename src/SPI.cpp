@@ -14,6 +14,7 @@ void SPIMaster::enable() const {
 	DDB3.set();   // MOSI is output
 	DDB4.clear(); // MISO is input
 	DDB5.set();   // SCK  is output;
+	PRSPI.clear(); // start the SPI clock, in case it was powered down, before writing SPCR
         SPIE.clear(); // no interrupts
 	MSTR.set();   // in master mode
 	SPE.set();    // enable SPI
@@ -0,0 +1,40 @@
+#include "HAL/Atmel/Stack.hpp"
+
+#ifdef AVR
+#include <avr/io.h>
+
+extern "C" uint8_t __heap_start;
+
+/**
+ * Runs before .init4 copies .data and clears .bss, which is fine since painting stops at __heap_start. Being naked
+ * and in an .init section, this must not call functions or return. The loop is written in assembly, since the
+ * compiler may turn a C loop into a call to memset(), whose return address would be painted over.
+ */
+void paintStackOnInit() __attribute__((naked, used, section(".init3")));
+void paintStackOnInit() {
+    uint8_t *p = &__heap_start;
+    uint8_t *end = (uint8_t*) SP;
+    __asm__ __volatile__ (
+        "rjmp 2f" "\n\t"
+        "1: st X+, %[canary]" "\n\t"
+        "2: cp r26, %A[end]" "\n\t"
+        "cpc r27, %B[end]" "\n\t"
+        "brlo 1b" "\n\t"
+        : "+x" (p)
+        : [end] "r" (end), [canary] "r" (HAL::Atmel::Impl::stackCanary)
+        : "memory");
+}
+
+uint16_t HAL::Atmel::stackHighWater() {
+    return HAL::Atmel::Impl::countPainted(&__heap_start, (const uint8_t*) SP);
+}
+
+#else
+
+HAL::Atmel::Impl::SimulatedStack HAL::Atmel::Impl::simulatedStack = { nullptr, nullptr };
+
+uint16_t HAL::Atmel::stackHighWater() {
+    return HAL::Atmel::Impl::countPainted(HAL::Atmel::Impl::simulatedStack.begin, HAL::Atmel::Impl::simulatedStack.end);
+}
+
+#endif
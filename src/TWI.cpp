@@ -0,0 +1,3 @@
+#include "HAL/Atmel/TWI.hpp"
+
+volatile bool HAL::Atmel::Impl::TWIBus::transceiving = false;
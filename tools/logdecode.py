@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""
+Decodes binary log records, as written by loggers using Logging::MessagesBinary, back into text.
+
+Usage:
+    logdecode.py firmware.elf [capture.bin]      decode using the strings in the application's ELF file
+    logdecode.py --table strings.txt [capture]   decode using a table of "<id> <string>" lines
+
+Reads the capture (e.g. a raw dump of the serial port) from stdin if no file is given.
+
+Each record is a 2-byte string ID of its format ("<logger>:<codes>"), followed by one field per code:
+    s  2-byte string ID        c  char           ?  bool
+    B/b, H/h, I/i              decimal uint8/int8, uint16/int16, uint32/int32
+    1, 2, 4                    hexadecimal of that many bytes
+    -                          argument that has no binary encoding, has no bytes
+All values are little-endian. On AVR, string IDs are flash addresses.
+"""
+
+import struct
+import sys
+
+SIZES = {'s': 2, 'c': 1, '?': 1, 'B': 1, 'b': 1, 'H': 2, 'h': 2, 'I': 4, 'i': 4, '1': 1, '2': 2, '4': 4, '-': 0}
+STRUCT = {'s': '<H', 'B': '<B', 'b': '<b', 'H': '<H', 'h': '<h', 'I': '<I', 'i': '<i',
+          '1': '<B', '2': '<H', '4': '<I'}
+
+
+class ElfStrings:
+    """Looks up NUL-terminated strings by address in the allocated sections of a 32-bit little-endian ELF file."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError('%s is not a 32-bit little-endian ELF file' % path)
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from('<IIIIII', self.data, shoff + i * shentsize)
+            SHF_ALLOC, SHT_NOBITS = 0x2, 8
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS:
+                self.sections.append((addr, offset, size))
+
+    def get(self, id):
+        for (addr, offset, size) in self.sections:
+            if addr <= id < addr + size:
+                start = offset + id - addr
+                end = self.data.index(b'\0', start)
+                return self.data[start:end].decode('latin-1')
+        return None
+
+
+class TableStrings:
+    def __init__(self, path):
+        self.strings = {}
+        with open(path) as f:
+            for line in f:
+                id, _, string = line.rstrip('\n').partition(' ')
+                self.strings[int(id, 0)] = string
+
+    def get(self, id):
+        return self.strings.get(id)
+
+
+def decode(strings, data):
+    pos = 0
+    while pos + 2 <= len(data):
+        id, = struct.unpack_from('<H', data, pos)
+        fmt = strings.get(id)
+        if fmt is None or ':' not in fmt:
+            # Not at a record start, e.g. after a dropped byte. Resynchronize.
+            pos += 1
+            continue
+        logger, _, codes = fmt.rpartition(':')
+        size = sum(SIZES.get(code, 0) for code in codes)
+        if pos + 2 + size > len(data):
+            break
+        pos += 2
+        out = []
+        for code in codes:
+            if code == 'c':
+                out.append(chr(data[pos]))
+            elif code == '?':
+                out.append(str(data[pos] != 0))
+            elif code == '-':
+                out.append('-')
+            else:
+                value, = struct.unpack_from(STRUCT[code], data, pos)
+                if code == 's':
+                    out.append(strings.get(value) or '<%04x>' % value)
+                elif code in '124':
+                    out.append('%0*X' % (2 * SIZES[code], value))
+                else:
+                    out.append(str(value))
+            pos += SIZES[code]
+        print('%s: %s' % (logger, ''.join(out)))
+
+
+def main(args):
+    if len(args) >= 2 and args[0] == '--table':
+        strings = TableStrings(args[1])
+        args = args[2:]
+    elif len(args) >= 1:
+        strings = ElfStrings(args[0])
+        args = args[1:]
+    else:
+        print(__doc__)
+        return 1
+    if args:
+        with open(args[0], 'rb') as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    decode(strings, data)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
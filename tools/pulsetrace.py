@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+Reads and writes pulse traces, as recorded by Serial::PulseRecorder and replayed by tst/PulseReplay.hpp.
+
+Usage:
+    pulsetrace.py dump [capture.bin]     print a recorded trace as text, reading stdin if no file is given
+    pulsetrace.py synth [directory]      write the synthetic noisy traces used by the tests (default tst/traces)
+
+A trace starts with a 5-byte header: 'P', 'T', CPU clock in MHz, the timer's prescalerPower2, and unitPower2.
+Each pulse follows as one byte: its level in the top bit, and its length in units of 2^unitPower2 timer counts
+in the lower 7 bits. A length of 127 is followed by the exact length as little-endian 16-bit counts. A 0 byte
+is a timeout, or a gap where the recorder had to drop pulses.
+"""
+
+import random
+import struct
+import sys
+
+ESCAPE = 127
+HIGH = 0x80
+
+# The synthetic traces are on a 16MHz CPU with timer prescaler 8, i.e. 0.5us per count.
+MHZ = 16
+PRESCALER_POWER2 = 3
+UNIT_POWER2 = 4
+
+
+def parse(data):
+    """Returns (mhz, prescalerPower2, unitPower2, [(high, counts)]) for a trace, ignoring bytes before the header."""
+    start = data.find(b'PT')
+    if start < 0 or start + 5 > len(data):
+        raise ValueError('No trace header found')
+    mhz, prescaler_power2, unit_power2 = data[start + 2], data[start + 3], data[start + 4]
+    pulses = []
+    pos = start + 5
+    while pos < len(data):
+        b = data[pos]
+        pos += 1
+        high = (b & HIGH) != 0
+        units = b & ~HIGH
+        if units == ESCAPE:
+            if pos + 2 > len(data):
+                break
+            counts, = struct.unpack_from('<H', data, pos)
+            pos += 2
+        else:
+            counts = units << unit_power2
+        pulses.append((high, counts))
+    return mhz, prescaler_power2, unit_power2, pulses
+
+
+def encode(pulses, mhz=MHZ, prescaler_power2=PRESCALER_POWER2, unit_power2=UNIT_POWER2):
+    out = bytearray(b'PT')
+    out += bytes([mhz, prescaler_power2, unit_power2])
+    for high, counts in pulses:
+        counts = min(counts, 0xFFFF)
+        units = (counts + ((1 << unit_power2) >> 1)) >> unit_power2
+        level = HIGH if high else 0
+        if units < ESCAPE:
+            out.append(level | (1 if units == 0 and counts != 0 else units))
+        else:
+            out.append(level | ESCAPE)
+            out += struct.pack('<H', counts)
+    return bytes(out)
+
+
+def dump(data):
+    mhz, prescaler_power2, unit_power2, pulses = parse(data)
+    us_per_count = (1 << prescaler_power2) / mhz
+    print('# %dMHz, prescaler %d, unit %d counts, %d pulses' % (mhz, 1 << prescaler_power2, 1 << unit_power2,
+                                                                 len(pulses)))
+    for high, counts in pulses:
+        if counts == 0:
+            print('-')
+        else:
+            print('%s %d (%dus)' % ('H' if high else 'L', counts, counts * us_per_count))
+
+
+class Synth:
+    """Builds a pulse sequence in microseconds, with receiver jitter and noise, and converts it to counts."""
+
+    def __init__(self, seed):
+        self.random = random.Random(seed)
+        self.pulses = []
+
+    def pulse(self, high, us):
+        # OOK receivers tend to stretch high pulses, and jitter every edge a little.
+        us *= self.random.gauss(1.03 if high else 0.97, 0.04)
+        self.pulses.append((high, max(1, int(us * MHZ) >> PRESCALER_POWER2)))
+
+    def noise(self, count):
+        high = self.random.random() < 0.5
+        for i in range(count):
+            us = self.random.randint(5, 10000 if i % 4 == 0 else 150)
+            self.pulses.append((high, max(1, int(us * MHZ) >> PRESCALER_POWER2)))
+            high = not high
+
+    def glitch(self):
+        """Splits a random pulse of the last packet with a short spike of the opposite level."""
+        i = len(self.pulses) - self.random.randint(3, 40)
+        high, counts = self.pulses[i]
+        spike = 30 * MHZ >> PRESCALER_POWER2
+        self.pulses[i:i + 1] = [(high, counts // 3), (not high, spike), (high, counts - counts // 3 - spike)]
+
+    def bits(self, data, zero, one, parity=None):
+        for byte in data:
+            ones = 0
+            for i in range(7, -1, -1):
+                bit = (byte >> i) & 1
+                ones += bit
+                self.pair(one if bit else zero)
+            if parity == 'even':
+                self.pair(one if ones % 2 else zero)
+
+    def pair(self, pulses):
+        for high, us in pulses:
+            self.pulse(high, us)
+
+    def fs20(self, house_code, address, command):
+        zero = ((True, 400), (False, 400))
+        one = ((True, 600), (False, 600))
+        for i in range(12):
+            self.pair(zero)
+        self.pair(one)
+        data = [house_code >> 8, house_code & 0xFF, address, command]
+        self.bits(data + [(6 + sum(data)) & 0xFF], zero, one, parity='even')
+        self.pair(zero)
+
+    def nec(self, code):
+        # IR receivers are active low, so marks are low and spaces are high.
+        self.pulse(False, 9000)
+        self.pulse(True, 4500)
+        self.bits(struct.pack('>I', code), ((False, 560), (True, 560)), ((False, 560), (True, 1690)))
+        self.pulse(False, 560)
+        self.pulse(True, 560)
+
+    def nec_repeat(self):
+        self.pulse(True, 30000)
+        self.pulse(False, 9000)
+        self.pulse(True, 2250)
+        self.pulse(False, 560)
+
+    def write(self, path):
+        with open(path, 'wb') as f:
+            f.write(encode(self.pulses))
+
+
+def synth(directory):
+    # 20 FS20 packets for house code 0x1B2C between noise, of which packets 5, 11 and 17 are broken by a spike.
+    s = Synth(1)
+    for i in range(20):
+        s.noise(200)
+        s.fs20(0x1B2C, i, 0x10)
+        if i % 6 == 5:
+            s.glitch()
+        s.pulses.append((False, 0))
+    s.noise(200)
+    s.write(directory + '/fs20-noisy.pulses')
+
+    # 20 NEC codes with 2 repeats each between noise, of which codes 5, 11 and 17 are broken by a spike.
+    s = Synth(2)
+    for i in range(20):
+        s.noise(200)
+        s.nec(0x10EF00FF + (i << 8) - i)
+        if i % 6 == 5:
+            s.glitch()
+        s.nec_repeat()
+        s.nec_repeat()
+        s.pulses.append((False, 0))
+    s.noise(200)
+    s.write(directory + '/nec-noisy.pulses')
+
+    # Only noise, to measure false positives.
+    s = Synth(3)
+    s.noise(20000)
+    s.write(directory + '/noise.pulses')
+
+
+def main(args):
+    if args and args[0] == 'dump':
+        if len(args) > 1:
+            with open(args[1], 'rb') as f:
+                data = f.read()
+        else:
+            data = sys.stdin.buffer.read()
+        dump(data)
+    elif args and args[0] == 'synth':
+        synth(args[1] if len(args) > 1 else 'tst/traces')
+    else:
+        print(__doc__)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
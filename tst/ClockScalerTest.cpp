@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "HAL/Atmel/ClockScaler.hpp"
+#include "Time/RealTimer.hpp"
+#include "invoke.hpp"
+
+namespace ClockScalerTest {
+
+using namespace HAL::Atmel;
+using namespace HAL::Atmel::Registers;
+using namespace Time;
+
+void resetPeripherals() {
+    UCSR0A.set(0);
+    UCSR0B.set(0);
+    SPCR.set(0);
+    TWCR.set(0);
+    TCCR0B.set(0);
+    TCCR1B.set(0);
+    TCCR2B.set(0);
+    ASSR.set(0);
+    CLKPR.set(0);
+    TCNT0.set(0);
+}
+
+/**
+ * Simulates timer 0 counting off a system clock that is divided according to CLKPR.
+ */
+template <typename rt_t>
+struct SimulatedTimer0 {
+    rt_t *rt;
+    uint32_t cycles = 0;
+
+    static uint16_t prescaler() {
+        switch (TCCR0B.get() & 0x07) {
+        case 1: return 1;
+        case 2: return 8;
+        case 3: return 64;
+        case 4: return 256;
+        case 5: return 1024;
+        default: return 0;
+        }
+    }
+
+    /** Advances real time by the given number of F_CPU cycles */
+    void run(uint32_t fullSpeedCycles) {
+        const uint8_t divider = CLKPR.get() & 0x0F;
+        for (uint32_t i = 0; i < (fullSpeedCycles >> divider); i++) {
+            cycles++;
+            if (cycles >= prescaler()) {
+                cycles = 0;
+                const uint8_t next = TCNT0.get() + 1;
+                TCNT0.set(next);
+                if (next == 0) {
+                    invoke<Int_TIMER0_OVF_>(*rt);
+                }
+            }
+        }
+    }
+
+    void runMillis(uint32_t ms) {
+        for (uint32_t i = 0; i < ms; i++) {
+            run(F_CPU / 1000);
+        }
+    }
+};
+
+TEST(ClockScalerTest, millis_are_continuous_across_frequency_switches) {
+    resetPeripherals();
+    auto timer = Timer0::withPrescaler<64>::inNormalMode();
+    auto rt = realTimer(timer);
+    auto scaler = clockScaler<3>(rt);
+    SimulatedTimer0<decltype(rt)> sim = { &rt };
+
+    sim.runMillis(1000);
+    EXPECT_NEAR(1000, rt.millis().getValue(), 1);
+
+    EXPECT_TRUE(scaler.scaleDown());
+    EXPECT_TRUE(scaler.isScaled());
+    EXPECT_EQ(3, CLKPR.get());
+    EXPECT_EQ(8, sim.prescaler());
+    sim.runMillis(1000);
+    EXPECT_NEAR(2000, rt.millis().getValue(), 1);
+
+    scaler.scaleUp();
+    EXPECT_FALSE(scaler.isScaled());
+    EXPECT_EQ(0, CLKPR.get());
+    EXPECT_EQ(64, sim.prescaler());
+    sim.runMillis(1000);
+    EXPECT_NEAR(3000, rt.millis().getValue(), 1);
+}
+
+TEST(ClockScalerTest, can_scale_down_to_prescaler_1) {
+    resetPeripherals();
+    auto timer = Timer0::withPrescaler<64>::inNormalMode();
+    auto rt = realTimer(timer);
+    auto scaler = clockScaler<6>(rt);
+    SimulatedTimer0<decltype(rt)> sim = { &rt };
+
+    EXPECT_TRUE(scaler.scaleDown());
+    EXPECT_EQ(6, CLKPR.get());
+    EXPECT_EQ(1, sim.prescaler());
+    sim.runMillis(500);
+    scaler.scaleUp();
+    sim.runMillis(500);
+    EXPECT_NEAR(1000, rt.millis().getValue(), 1);
+}
+
+TEST(ClockScalerTest, refuses_while_peripherals_need_exact_timing) {
+    resetPeripherals();
+    auto timer = Timer0::withPrescaler<64>::inNormalMode();
+    auto rt = realTimer(timer);
+    auto scaler = clockScaler<3>(rt);
+
+    RXEN0.set();
+    EXPECT_FALSE(scaler.scaleDown());
+    RXEN0.clear();
+
+    SPE.set();
+    EXPECT_FALSE(scaler.scaleDown());
+    SPE.clear();
+
+    // e.g. a pulse counter on timer 2
+    CS21.set();
+    EXPECT_FALSE(scaler.scaleDown());
+    CS21.clear();
+
+    EXPECT_EQ(0, CLKPR.get());
+    EXPECT_EQ(64, SimulatedTimer0<decltype(rt)>::prescaler());
+    EXPECT_TRUE(scaler.scaleDown());
+    scaler.scaleUp();
+}
+
+}
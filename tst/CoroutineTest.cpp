@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "Tasks/Coroutine.hpp"
+#include "Time/RealTimer.hpp"
+#include "Fifo.hpp"
+#include "Mocks.hpp"
+
+namespace CoroutineTest {
+
+using namespace Mocks;
+using namespace Time;
+using namespace HAL::Atmel;
+
+struct Sequence {
+    MockRealTimer rt;
+    VariableDeadline<MockRealTimer> timeout = { rt };
+    Fifo<4> fifo;
+    Coroutine co;
+    uint8_t step = 0;
+    uint8_t received = 0;
+
+    void loop() {
+        AVR_CO_BEGIN(co);
+        step = 1;
+        AVR_CO_YIELD(co);
+        step = 2;
+        timeout.schedule(100_ms);
+        AVR_CO_AWAIT_DEADLINE(co, timeout, SleepMode::POWER_DOWN);
+        step = 3;
+        AVR_CO_AWAIT(co, fifo.hasContent(), SleepMode::IDLE);
+        fifo.read(&received);
+        step = 4;
+        AVR_CO_END(co);
+    }
+
+    TaskState getTaskState() const {
+        return co.getTaskState(timeout);
+    }
+};
+
+TEST(CoroutineTest, resumes_after_yield_deadline_and_event) {
+    Sequence s;
+    EXPECT_FALSE(s.getTaskState().isIdle());
+    EXPECT_EQ(0, s.getTaskState().timeLeft());
+
+    s.loop();
+    EXPECT_EQ(1, s.step);
+    EXPECT_EQ(Coroutine::Awaiting::NEXT_LOOP, s.co.getAwaiting());
+    EXPECT_EQ(0, s.getTaskState().timeLeft());
+
+    s.loop();
+    EXPECT_EQ(2, s.step);
+    EXPECT_EQ(Coroutine::Awaiting::DEADLINE, s.co.getAwaiting());
+    EXPECT_NEAR(100, s.getTaskState().timeLeft().getValue(), 1);
+    EXPECT_EQ(SleepMode::POWER_DOWN, s.getTaskState().getMaxSleepMode());
+
+    s.rt.advance(50_ms);
+    s.loop();
+    EXPECT_EQ(2, s.step);
+    EXPECT_NEAR(50, s.getTaskState().timeLeft().getValue(), 1);
+
+    s.rt.advance(50_ms);
+    s.loop();
+    EXPECT_EQ(3, s.step);
+    EXPECT_EQ(Coroutine::Awaiting::EVENT, s.co.getAwaiting());
+    EXPECT_FALSE(s.getTaskState().isIdle());
+    EXPECT_EQ(SleepMode::IDLE, s.getTaskState().getMaxSleepMode());
+
+    s.loop();
+    EXPECT_EQ(3, s.step);
+
+    s.fifo.write(uint8_t(42));
+    s.loop();
+    EXPECT_EQ(4, s.step);
+    EXPECT_EQ(42, s.received);
+    EXPECT_TRUE(s.co.isFinished());
+    EXPECT_TRUE(s.getTaskState().isIdle());
+
+    s.loop();
+    EXPECT_EQ(4, s.step);
+}
+
+TEST(CoroutineTest, restart_starts_over_and_stop_finishes) {
+    Sequence s;
+    s.loop();
+    s.loop();
+    EXPECT_EQ(2, s.step);
+
+    s.co.restart();
+    s.loop();
+    EXPECT_EQ(1, s.step);
+
+    s.co.stop();
+    s.loop();
+    EXPECT_EQ(1, s.step);
+    EXPECT_TRUE(s.getTaskState().isIdle());
+}
+
+TEST(CoroutineTest, does_not_start_until_restarted_if_created_stopped) {
+    Coroutine co(false);
+    EXPECT_TRUE(co.isFinished());
+    EXPECT_TRUE(co.getTaskState().isIdle());
+    co.restart();
+    EXPECT_FALSE(co.getTaskState().isIdle());
+}
+
+}
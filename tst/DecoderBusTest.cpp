@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "Serial/DecoderBus.hpp"
+#include "FS20/FS20Decoder.hpp"
+#include "Visonic/VisonicDecoder.hpp"
+#include "Mocks.hpp"
+#include "RecordedPulses.hpp"
+
+namespace DecoderBusTest {
+
+using namespace Serial;
+using RecordedPulses::fs20;
+using RecordedPulses::visonic;
+
+struct MockPulseCounter {
+    typedef uint16_t count_t;
+    typedef Mocks::MockComparator<uint16_t, 3> comparator_t;
+};
+
+typedef FS20::FS20Decoder<MockPulseCounter> FS20_t;
+typedef Visonic::VisonicDecoder<MockPulseCounter> Visonic_t;
+
+/** Noise as an OOK receiver outputs it between packets, then an FS20 packet, more noise, and a Visonic packet. */
+std::vector<Pulse> receivedPulses() {
+    std::vector<Pulse> result;
+    uint32_t seed = 12345;
+    bool high = true;
+    auto noise = [&] {
+        for (uint8_t i = 0; i < 200; i++) {
+            seed = seed * 1103515245 + 12345;
+            result.push_back(Pulse(high, 10 + (seed >> 16) % ((i % 4 == 0) ? 20000 : 300)));
+            high = !high;
+        }
+    };
+    auto packet = [&] (const uint16_t *seq, uint8_t length) {
+        high = true;
+        for (uint8_t i = 0; i < length; i++) {
+            result.push_back(Pulse(high, seq[i]));
+            high = !high;
+        }
+        result.push_back(Pulse::empty());
+    };
+    noise();
+    packet(fs20, std::extent<decltype(fs20)>::value);
+    noise();
+    packet(visonic, std::extent<decltype(visonic)>::value);
+    noise();
+    return result;
+}
+
+TEST(DecoderBusTest, bus_decodes_the_same_packets_as_feeding_each_decoder) {
+    const auto pulses = receivedPulses();
+    FS20_t fs20Decoder;
+    Visonic_t visonicDecoder;
+    DecoderBus<FS20_t, Visonic_t> bus;
+
+    for (const Pulse &pulse: pulses) {
+        fs20Decoder.apply(pulse);
+        visonicDecoder.apply(pulse);
+        bus.apply(pulse);
+    }
+
+    FS20::FS20Packet fs20Expected, fs20Actual;
+    EXPECT_TRUE(fs20Decoder.read(&fs20Expected));
+    EXPECT_TRUE(bus.decoder<0>().read(&fs20Actual));
+    EXPECT_EQ(27, fs20Actual.houseCodeHi);
+    EXPECT_EQ(fs20Expected.houseCodeLo, fs20Actual.houseCodeLo);
+    EXPECT_FALSE(bus.decoder<0>().read(&fs20Actual));
+
+    Visonic::VisonicPacket visonicExpected, visonicActual;
+    while (visonicDecoder.read(&visonicExpected)) {
+        EXPECT_TRUE(bus.decoder<1>().read(&visonicActual));
+        for (uint8_t i = 0; i < 5; i++) {
+            EXPECT_EQ(visonicExpected.data[i], visonicActual.data[i]);
+        }
+    }
+    EXPECT_FALSE(bus.decoder<1>().read(&visonicActual));
+}
+
+TEST(DecoderBusTest, idle_decoders_are_skipped_for_pulses_they_cant_match) {
+    DecoderBus<FS20_t, Visonic_t> bus;
+    EXPECT_TRUE(bus.decoder<0>().isIdle());
+    EXPECT_TRUE(bus.decoder<1>().isIdle());
+
+    bus.apply(Pulse(true, 5000));
+    EXPECT_TRUE(bus.decoder<0>().isIdle());
+    EXPECT_TRUE(bus.decoder<1>().isIdle());
+
+    bus.apply(Pulse(true, 800));
+    EXPECT_FALSE(bus.decoder<0>().isIdle());
+    EXPECT_FALSE(bus.decoder<1>().isIdle());
+
+    bus.apply(Pulse::empty());
+    EXPECT_TRUE(bus.decoder<0>().isIdle());
+    EXPECT_TRUE(bus.decoder<1>().isIdle());
+}
+
+TEST(DecoderBusTest, benchmark_bus_against_feeding_each_decoder) {
+    const auto pulses = receivedPulses();
+    constexpr int rounds = 200;
+    typedef std::chrono::steady_clock clock;
+
+    FS20_t fs20Decoder;
+    Visonic_t visonicDecoder;
+    FS20::FS20Packet fs20Pkt;
+    Visonic::VisonicPacket visonicPkt;
+    const auto sequentialStart = clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const Pulse &pulse: pulses) {
+            fs20Decoder.apply(pulse);
+            visonicDecoder.apply(pulse);
+        }
+        while (fs20Decoder.read(&fs20Pkt)) ;
+        while (visonicDecoder.read(&visonicPkt)) ;
+    }
+    const auto sequential = clock::now() - sequentialStart;
+
+    DecoderBus<FS20_t, Visonic_t> bus;
+    const auto busStart = clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const Pulse &pulse: pulses) {
+            bus.apply(pulse);
+        }
+        while (bus.decoder<0>().read(&fs20Pkt)) ;
+        while (bus.decoder<1>().read(&visonicPkt)) ;
+    }
+    const auto onBus = clock::now() - busStart;
+
+    const auto n = double(rounds * pulses.size());
+    std::cout << "ns per pulse, sequential: " << std::chrono::duration<double, std::nano>(sequential).count() / n
+              << ", bus: " << std::chrono::duration<double, std::nano>(onBus).count() / n << std::endl;
+}
+
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include "Serial/InputCapturePulseCounter.hpp"
+#include "FS20/FS20Decoder.hpp"
+#include "Mocks.hpp"
+#include "RecordedPulses.hpp"
+#include "invoke.hpp"
+
+namespace InputCapturePulseCounterTest {
+
+using namespace Serial;
+using RecordedPulses::fs20;
+using namespace HAL::Atmel;
+using namespace HAL::Atmel::Registers;
+
+typedef Mocks::MockComparator<uint16_t, 3> MockComparator;
+
+template <typename counter_t>
+void edgeAt(counter_t &pc, uint16_t time) {
+    ICR1.set(time);
+    invoke<Int_TIMER1_CAPT_>(pc);
+}
+
+TEST(InputCapturePulseCounterTest, captures_opposite_edge_each_time_and_reads_latched_time) {
+    MockComparator comp;
+    comp.value = 100;
+    PINB0.set();
+    TCCR1B.set(0);
+    auto pc = inputCapturePulseCounter<64>(comp);
+    EXPECT_TRUE(ICIE1.isSet());
+    EXPECT_FALSE(ICES1.isSet());  // pin is high, so waiting for a falling edge
+    EXPECT_TRUE(PORTB0.isSet());
+    EXPECT_EQ(99, comp.target);
+
+    comp.value = 400;  // interrupt latency doesn't matter
+    edgeAt(pc, 130);
+    EXPECT_TRUE(ICES1.isSet());
+    EXPECT_EQ(129, comp.target);
+    EXPECT_TRUE(comp.isInterruptOn);
+
+    edgeAt(pc, 150);
+    EXPECT_FALSE(ICES1.isSet());
+
+    bool high = false;
+    uint16_t duration = 0;
+    pc.on([&] (auto pulse) { high = pulse.isHigh(); duration = pulse.getDuration(); });
+    EXPECT_TRUE(high);
+    EXPECT_EQ(30, duration);
+    pc.on([&] (auto pulse) { high = pulse.isHigh(); duration = pulse.getDuration(); });
+    EXPECT_FALSE(high);
+    EXPECT_EQ(20, duration);
+    EXPECT_FALSE(pc.hasPulses());
+}
+
+TEST(InputCapturePulseCounterTest, measures_long_pulses_across_timer_wrap_and_reports_timeout) {
+    MockComparator comp;
+    comp.value = 65000;
+    PINB0.clear();
+    auto pc = inputCapturePulseCounter<64>(comp);
+    EXPECT_TRUE(ICES1.isSet());
+
+    edgeAt(pc, uint16_t(65000 + 60000));  // wraps around to 59464
+    comp.advanceToTargetAndInvoke(pc);
+    EXPECT_FALSE(comp.isInterruptOn);
+
+    uint16_t durations[2] = {};
+    uint8_t count = 0;
+    pc.onMax(5, [&] (auto pulse) { durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(60000, durations[0]);
+    EXPECT_EQ(0, durations[1]);
+}
+
+TEST(InputCapturePulseCounterTest, reports_overflow_when_fifo_is_full) {
+    MockComparator comp;
+    PINB0.set();
+    auto pc = inputCapturePulseCounter<8>(comp);
+    for (uint16_t t = 10; t <= 50; t += 10) {
+        edgeAt(pc, t);
+    }
+    uint8_t count = 0;
+    pc.onMax(10, [&] (auto pulse) { count++; });
+    EXPECT_EQ(2, count);
+}
+
+TEST(InputCapturePulseCounterTest, compact_encoding_fits_three_times_the_pulses_in_the_fifo) {
+    MockComparator comp;
+    PINB0.set();
+    auto pc = inputCapturePulseCounter<8, PulseEncoding::Compact<4>>(comp);
+    for (uint16_t t = 160; t <= 960; t += 160) {
+        edgeAt(pc, t);
+    }
+    EXPECT_EQ(0, pc.getOverflows());
+
+    uint16_t durations[6] = {};
+    bool high[6] = {};
+    uint8_t count = 0;
+    pc.onMax(10, [&] (auto pulse) { high[count] = pulse.isHigh(); durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(6, count);
+    for (uint8_t i = 0; i < 6; i++) {
+        EXPECT_EQ(160, durations[i]);
+        EXPECT_EQ(i % 2 == 0, high[i]);
+    }
+}
+
+TEST(InputCapturePulseCounterTest, fs20_decoder_works_unchanged_on_captured_pulses) {
+    MockComparator comp;
+    comp.value = 50000;
+    PINB0.set();
+    auto pc = inputCapturePulseCounter<32>(comp);
+    FS20::FS20Decoder<decltype(pc)> decoder;
+
+    uint16_t t = 50000;
+    for (uint16_t d: fs20) {
+        t += d;
+        edgeAt(pc, t);
+        pc.onMax(4, [&] (auto pulse) { decoder.apply(pulse); });
+    }
+    comp.advanceToTargetAndInvoke(pc);
+    pc.onMax(4, [&] (auto pulse) { decoder.apply(pulse); });
+
+    FS20::FS20Packet pkt;
+    EXPECT_TRUE(decoder.read(&pkt));
+    EXPECT_EQ(27, pkt.houseCodeHi);
+    EXPECT_EQ(255, pkt.houseCodeLo);
+    EXPECT_EQ(0, pkt.address);
+    EXPECT_EQ(0, pkt.command);
+}
+
+}
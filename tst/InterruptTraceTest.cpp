@@ -0,0 +1,96 @@
+#include "avr/common.h"
+#include "HAL/Atmel/InterruptHandlers.hpp"
+#include "HAL/Atmel/Device.hpp"
+#include "Fifo.hpp"
+#include <gtest/gtest.h>
+
+namespace InterruptTraceTest {
+
+using namespace HAL::Atmel;
+using namespace HAL::Atmel::Registers;
+using namespace InterruptHandlers;
+
+void advance(uint16_t counts) {
+    TCNT1.set(TCNT1.get() + counts);
+}
+
+struct TheApp {
+    typedef TheApp This;
+    uint16_t work = 100;
+
+    void onINT0() {
+        advance(work);
+    }
+
+    void onINT1();
+
+    typedef On<This, Int_INT0_, &This::onINT0,
+            On<This, Int_INT1_, &This::onINT1>> Handlers;
+};
+
+TheApp app;
+mkISRS
+
+// Simulates an ISR that re-enables interrupts, and is interrupted by INT0 halfway.
+void TheApp::onINT1() {
+    advance(10);
+    INT0_vect();
+    advance(10);
+}
+
+TEST(InterruptTraceTest, vectors_record_count_max_and_total) {
+    clearInterruptTrace();
+    TCNT1.set(0);
+    app.work = 100;
+    INT0_vect();
+    advance(1000);
+    app.work = 300;
+    INT0_vect();
+
+    const VectorTrace t = getInterruptTrace(1);
+    EXPECT_EQ(2, t.count);
+    EXPECT_EQ(300, t.max);
+    EXPECT_EQ(400u, t.total);
+    EXPECT_EQ(0, t.nested);
+    EXPECT_EQ(0, t.backToBack);
+    EXPECT_EQ(0, getInterruptTrace(2).count);
+}
+
+TEST(InterruptTraceTest, nested_and_back_to_back_vectors_are_counted) {
+    clearInterruptTrace();
+    TCNT1.set(65500);  // spans a TCNT1 overflow
+    app.work = 50;
+    INT1_vect();
+    INT0_vect();
+    advance(1000);
+    INT0_vect();
+
+    const VectorTrace int0 = getInterruptTrace(1);
+    EXPECT_EQ(3, int0.count);
+    EXPECT_EQ(1, int0.nested);
+    EXPECT_EQ(1, int0.backToBack);
+    const VectorTrace int1 = getInterruptTrace(2);
+    EXPECT_EQ(1, int1.count);
+    EXPECT_EQ(70, int1.max);
+    EXPECT_EQ(0, int1.nested);
+}
+
+TEST(InterruptTraceTest, trace_is_written_to_a_fifo) {
+    clearInterruptTrace();
+    TCNT1.set(0);
+    app.work = 42;
+    INT0_vect();
+
+    Fifo<64> out;
+    writeInterruptTrace(out);
+    char line[64] = {};
+    uint8_t i = 0;
+    while (out.hasContent() && i < sizeof(line) - 1) {
+        uint8_t c;
+        out.read(&c);
+        line[i++] = c;
+    }
+    EXPECT_STREQ("V1 n=1 max=42 total=42 nested=0 b2b=0\r\n", line);
+}
+
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include "Logging.hpp"
+#include "Fifo.hpp"
+
+namespace LoggingTest {
+
+using namespace Logging;
+using namespace Streams;
+
+typedef MessagesEnabled<STR("Tasks")> TextLog;
+typedef MessagesBinary<STR("Tasks")> BinaryLog;
+
+uint16_t readUint16(Fifo<250> &fifo) {
+    uint8_t lo = 0, hi = 0;
+    fifo.read(&lo);
+    fifo.read(&hi);
+    return lo | (hi << 8);
+}
+
+TEST(LoggingTest, binary_record_has_format_id_string_ids_and_raw_arguments) {
+    Fifo<250> fifo;
+    auto msg = F("err=");
+
+    EXPECT_TRUE(BinaryLog::writeTo(fifo, msg, dec(uint16_t(300)), ' ', uint8_t(5), dec(int8_t(-2))));
+    EXPECT_EQ(9, fifo.getSize());
+
+    EXPECT_STREQ("Tasks:sHc1b", Logging::Impl::binaryString(readUint16(fifo)));
+    EXPECT_STREQ("err=", Logging::Impl::binaryString(readUint16(fifo)));
+    EXPECT_EQ(300, readUint16(fifo));
+    uint8_t b;
+    fifo.read(&b);
+    EXPECT_EQ(' ', b);
+    fifo.read(&b);
+    EXPECT_EQ(5, b);
+    fifo.read(&b);
+    EXPECT_EQ(0xFE, b);
+    EXPECT_FALSE(fifo.hasContent());
+}
+
+TEST(LoggingTest, binary_records_reuse_ids_and_skip_unsupported_arguments) {
+    Fifo<250> fifo;
+    const uint8_t values[] = { 1, 2, 3 };
+
+    BinaryLog::writeTo(fifo, F("x"), Decimal(values, 0, 3));
+    EXPECT_EQ(4, fifo.getSize());
+    const uint16_t format = readUint16(fifo);
+    const uint16_t x = readUint16(fifo);
+    EXPECT_STREQ("Tasks:s-", Logging::Impl::binaryString(format));
+
+    BinaryLog::writeTo(fifo, F("x"), Decimal(values, 0, 3));
+    EXPECT_EQ(format, readUint16(fifo));
+    EXPECT_EQ(x, readUint16(fifo));
+}
+
+TEST(LoggingTest, binary_record_is_not_written_partially) {
+    Fifo<4> fifo;
+    EXPECT_FALSE(BinaryLog::writeTo(fifo, F("count="), dec(uint32_t(100000))));
+    EXPECT_EQ(0, fifo.getSize());
+}
+
+template <typename log_t>
+void benchmark(const char *mode) {
+    constexpr uint32_t calls = 100000;
+    Fifo<250> fifo;
+    uint32_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+        // A typical statement, as printed by printTaskProfile()
+        log_t::writeTo(fifo, F("T"), dec(uint8_t(i & 0x0F)), F(" s:"), dec(uint16_t(i)), '/', dec(uint32_t(i * 30)),
+                       '/', dec(uint16_t(30)), F(" l:"), dec(uint16_t(i)), '/', dec(uint32_t(i * 120)), '/', dec(uint16_t(400)));
+        bytes += fifo.getSize();
+        fifo.clear();
+    }
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << mode << " logging: " << (bytes / calls) << " bytes, " << (ns / calls) << "ns per call on the host." << std::endl;
+}
+
+TEST(LoggingTest, binary_logging_writes_fewer_bytes_than_text) {
+    Fifo<250> text, binary;
+    TextLog::writeTo(text, F("T"), dec(uint8_t(3)), F(" s:"), dec(uint16_t(1234)), '/', dec(uint32_t(56789)));
+    BinaryLog::writeTo(binary, F("T"), dec(uint8_t(3)), F(" s:"), dec(uint16_t(1234)), '/', dec(uint32_t(56789)));
+    EXPECT_EQ(24, text.getSize());  // "Tasks: T3 s:1234/56789\r\n"
+    EXPECT_EQ(14, binary.getSize());
+
+    benchmark<TextLog>("Text");
+    benchmark<BinaryLog>("Binary");
+}
+
+TEST(LoggingTest, event_ring_returns_records_in_order_and_counts_dropped_ones) {
+    Logging::Impl::EventRing<4> ring;
+    uint8_t id;
+    uint16_t arg;
+    EXPECT_FALSE(ring.read(id, arg));
+
+    ring.write(1, 100);
+    ring.write(2, 200);
+    ring.write(3, 300);
+    ring.write(4, 400); // only size - 1 records fit
+    EXPECT_EQ(1, ring.takeDropped());
+    EXPECT_EQ(0, ring.takeDropped());
+
+    EXPECT_TRUE(ring.read(id, arg));
+    EXPECT_EQ(1, id);
+    EXPECT_EQ(100, arg);
+    ring.write(5, 500);
+    for (uint8_t expected: { 2, 3, 5 }) {
+        EXPECT_TRUE(ring.read(id, arg));
+        EXPECT_EQ(expected, id);
+        EXPECT_EQ(expected * 100, arg);
+    }
+    EXPECT_FALSE(ring.read(id, arg));
+}
+
+TEST(LoggingTest, events_are_only_recorded_for_enabled_loggers) {
+    Logging::Impl::events.clear();
+    Logging::event<Log<Loggers::Scanner>>(Event::TWI_STATUS, 0x08);
+    Logging::event<Log<Loggers::TWI>>(Event::TWI_STATUS, 0x18);
+
+    uint8_t id;
+    uint16_t arg;
+    EXPECT_TRUE(Logging::Impl::events.read(id, arg));
+    EXPECT_EQ(uint8_t(Event::TWI_STATUS), id);
+    EXPECT_EQ(0x18, arg);
+    EXPECT_FALSE(Logging::Impl::events.read(id, arg));
+
+    Logging::event<Log<Loggers::RFM12>>(Event::RFM12_UNDERRUN, 3);
+    printEvents();
+    EXPECT_FALSE(Logging::Impl::events.read(id, arg));
+}
+
+typedef TimingEnabled<STR("Probe")> Probe;
+
+void sample(uint16_t start, uint16_t end) {
+    HAL::Atmel::Registers::TCNT1.set(start);
+    Probe::timeStart();
+    HAL::Atmel::Registers::TCNT1.set(end);
+    Probe::timeEnd();
+}
+
+TEST(LoggingTest, timing_probe_keeps_count_min_max_mean_and_log2_histogram) {
+    Probe::clearProbe();
+    EXPECT_EQ(0, Probe::getProbe().count);
+
+    sample(100, 103);
+    sample(100, 110);
+    sample(65530, 20);  // TCNT1 wrapped
+    sample(0, 0);
+
+    const ProbeStats p = Probe::getProbe();
+    EXPECT_EQ(4, p.count);
+    EXPECT_EQ(0, p.min);
+    EXPECT_EQ(26, p.max);
+    EXPECT_EQ(39u, p.sum);
+    EXPECT_EQ(9, p.mean());
+    EXPECT_EQ(1, p.histogram[0]);
+    EXPECT_EQ(1, p.histogram[2]);  // 3
+    EXPECT_EQ(1, p.histogram[4]);  // 10
+    EXPECT_EQ(1, p.histogram[5]);  // 26
+
+    sample(0, 300);
+    sample(0, 65535);
+    EXPECT_EQ(1, Probe::getProbe().histogram[9]);
+    EXPECT_EQ(1, Probe::getProbe().histogram[16]);
+    EXPECT_EQ(65535, Probe::getProbe().max);
+
+    Probe::printProbe();
+    Probe::clearProbe();
+    EXPECT_EQ(0, Probe::getProbe().count);
+    EXPECT_EQ(0, Probe::getProbe().histogram[16]);
+}
+
+TEST(LoggingTest, timing_probe_stops_counting_when_saturated) {
+    ProbeStats p = {};
+    for (uint32_t i = 0; i < 70000; i++) {
+        p.add(65535);
+    }
+    EXPECT_EQ(65535, p.count);
+    EXPECT_EQ(65535u * 65535u, p.sum);
+    EXPECT_EQ(65535, p.mean());
+    EXPECT_EQ(65535, p.histogram[16]);
+}
+
+TEST(LoggingTest, print_probes_covers_loggers_with_and_without_timing) {
+    Log<Loggers::Tasks>::clearProbe();
+    HAL::Atmel::Registers::TCNT1.set(10);
+    Log<Loggers::Tasks>::timeStart();
+    HAL::Atmel::Registers::TCNT1.set(15);
+    Log<Loggers::Tasks>::timeEnd();
+    EXPECT_EQ(5, Log<Loggers::Tasks>::getProbe().max);
+
+    printProbes();
+    clearProbes();
+    EXPECT_EQ(0, Log<Loggers::Tasks>::getProbe().count);
+}
+
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "Tasks/Metrics.hpp"
+#include "Fifo.hpp"
+#include "Mocks.hpp"
+
+namespace MetricsTest {
+
+using namespace Mocks;
+using namespace Streams;
+
+struct Driver {
+    uint8_t packets = 0;
+    uint16_t errors = 0;
+    uint16_t freeBytes = 500;
+};
+
+struct Sender {
+    Fifo<32> fifo;
+    bool accept = true;
+
+    template <typename msg_t>
+    bool operator() (msg_t msg) {
+        return accept && fifo.write(msg);
+    }
+};
+
+template <typename rt_t>
+auto reporterFor(rt_t &rt, Driver &d, Sender &s) {
+    return metricsReporter(rt, 10_s,
+        [&s] (auto msg) { return s(msg); },
+        Metrics::counter<1>([&d] { return d.packets; }),
+        Metrics::counter<2>([&d] { return d.errors; }),
+        Metrics::gauge<3>([&d] { return d.freeBytes; }));
+}
+
+TEST(MetricsTest, first_report_contains_counters_and_changed_gauges_as_varints) {
+    MockRealTimer rt;
+    Driver d;
+    Sender s;
+    auto reporter = reporterFor(rt, d, s);
+    d.packets = 5;
+    d.errors = 300;
+
+    EXPECT_TRUE(reporter.report());
+    EXPECT_TRUE(s.fifo.read(FB(1 << 3, 5, 2 << 3, 0xAC, 0x02, 3 << 3, 0xF4, 0x03)));
+    EXPECT_TRUE(s.fifo.isEmpty());
+}
+
+TEST(MetricsTest, later_reports_only_contain_deltas_of_what_changed) {
+    MockRealTimer rt;
+    Driver d;
+    Sender s;
+    auto reporter = reporterFor(rt, d, s);
+    d.packets = 250;
+    reporter.report();
+    s.fifo.clear();
+
+    d.packets = 4;  // wrapped around
+    EXPECT_TRUE(reporter.report());
+    EXPECT_TRUE(s.fifo.read(FB(1 << 3, 10)));
+    EXPECT_TRUE(s.fifo.isEmpty());
+
+    d.freeBytes = 20;
+    EXPECT_TRUE(reporter.report());
+    EXPECT_TRUE(s.fifo.read(FB(3 << 3, 20)));
+
+    EXPECT_TRUE(reporter.report());
+    EXPECT_TRUE(s.fifo.isEmpty());
+}
+
+TEST(MetricsTest, failed_send_keeps_delta_for_next_report) {
+    MockRealTimer rt;
+    Driver d;
+    Sender s;
+    auto reporter = reporterFor(rt, d, s);
+    d.freeBytes = 0;
+    d.errors = 3;
+    s.accept = false;
+    EXPECT_FALSE(reporter.report());
+
+    d.errors = 7;
+    s.accept = true;
+    EXPECT_TRUE(reporter.report());
+    EXPECT_TRUE(s.fifo.read(FB(2 << 3, 7)));
+    EXPECT_TRUE(s.fifo.isEmpty());
+}
+
+TEST(MetricsTest, reports_when_periodic_elapses) {
+    MockRealTimer rt;
+    Driver d;
+    Sender s;
+    auto reporter = reporterFor(rt, d, s);
+    EXPECT_NEAR(10000, reporter.getTaskState().timeLeft().getValue(), 10);
+
+    d.packets = 1;
+    reporter.loop();
+    EXPECT_TRUE(s.fifo.isEmpty());
+
+    rt.advance(10_s);
+    reporter.loop();
+    EXPECT_TRUE(s.fifo.read(FB(1 << 3, 1, 3 << 3, 0xF4, 0x03)));
+}
+
+}
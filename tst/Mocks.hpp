@@ -141,6 +141,10 @@ struct MockPin {
         isInterruptOn = true;
     }
 
+    void interruptOnFalling() {
+        isInterruptOn = true;
+    }
+
     void interruptOff() {
         isInterruptOn = false;
     }
@@ -207,6 +211,8 @@ struct MockRFM12 {
     Fifo<250> sendFskStorage;
     ChunkedFifo sendFsk = { sendFskStorage };
 
+    typedef HAL::Atmel::InterruptHandlers::NoHandlers<MockRFM12> Handlers;
+
     ChunkedFifo::In in() { return recv.in(); }
 
     template <typename... types>
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "Serial/OOKDecoder.hpp"
+#include "Mocks.hpp"
+
+namespace OOKDecoderTest {
+
+using namespace Serial;
+using namespace Time;
+
+typedef Mocks::MockComparator<uint16_t, 3> MockComparator;
+
+struct DoorbellPacket {
+    uint8_t id = 0;
+    uint8_t chime = 0;
+    bool repeat = false;
+
+    typedef Streams::Protocol<DoorbellPacket> P;
+    typedef P::Seq<
+        P::Binary<uint8_t, &DoorbellPacket::id>,
+        P::Binary<uint8_t, &DoorbellPacket::chime>,
+        P::Binary<bool, &DoorbellPacket::repeat>
+    > DefaultProtocol;
+};
+
+/** A made-up doorbell: 2 bytes LSB first with odd parity, and a checksum byte that sums to 0. */
+struct DoorbellFormat {
+    typedef DoorbellPacket packet_t;
+
+    template <typename prescaled_t>
+    static constexpr OOKProtocol protocol() {
+        return OOKProtocol {
+            { { true, 1900, 2100 }, { false, 900, 1100 } }, 2,
+            { { true, 1900, 2100 }, { false, 3900, 4100 } }, 2,
+            /* syncBits */ 0,
+            { { true, 150, 250 }, { false, 350, 450 } },
+            { { true, 350, 450 }, { false, 150, 250 } },
+            SerialBitOrder::LSB_FIRST,
+            SerialParity::ODD,
+            &packetBytes,
+            &isValid };
+    }
+
+    static uint8_t packetBytes(const uint8_t *data, uint8_t bytes) {
+        return 3;
+    }
+
+    static bool isValid(const uint8_t *data, uint8_t bytes) {
+        return uint8_t(data[0] + data[1] + data[2]) == 0;
+    }
+
+    static DoorbellPacket toPacket(const uint8_t *data, uint8_t bytes) {
+        DoorbellPacket packet;
+        if (bytes == 0) {
+            packet.repeat = true;
+        } else {
+            packet.id = data[0];
+            packet.chime = data[1];
+        }
+        return packet;
+    }
+};
+
+typedef OOKDecoder<MockComparator, DoorbellFormat> DoorbellDecoder;
+
+std::vector<Pulse> doorbell(uint8_t id, uint8_t chime, bool flipParity = false) {
+    std::vector<Pulse> result = { Pulse(true, 2000), Pulse(false, 1000) };
+    const uint8_t bytes[] = { id, chime, uint8_t(-(id + chime)) };
+    for (uint8_t b: bytes) {
+        uint8_t ones = 0;
+        for (uint8_t i = 0; i < 9; i++) {
+            const bool one = (i < 8) ? ((b >> i) & 1) : (((ones % 2) == 0) != flipParity);
+            ones += one ? 1 : 0;
+            result.push_back(Pulse(true, one ? 400 : 200));
+            result.push_back(Pulse(false, one ? 200 : 400));
+        }
+    }
+    return result;
+}
+
+TEST(OOKDecoderTest, decodes_lsb_first_bytes_with_odd_parity_after_header) {
+    DoorbellDecoder decoder;
+    decoder.apply(Pulse(false, 30000));
+    for (auto pulse: doorbell(0x5A, 3)) {
+        decoder.apply(pulse);
+    }
+
+    DoorbellPacket packet;
+    EXPECT_TRUE(decoder.read(&packet));
+    EXPECT_EQ(0x5A, packet.id);
+    EXPECT_EQ(3, packet.chime);
+    EXPECT_FALSE(packet.repeat);
+    EXPECT_TRUE(decoder.isIdle());
+}
+
+TEST(OOKDecoderTest, drops_packets_with_wrong_parity_and_restarts_on_bad_pulses) {
+    DoorbellDecoder decoder;
+    for (auto pulse: doorbell(1, 2, true)) {
+        decoder.apply(pulse);
+    }
+    auto broken = doorbell(1, 2);
+    broken[10] = Pulse(true, 300);
+    for (auto pulse: broken) {
+        decoder.apply(pulse);
+    }
+    DoorbellPacket packet;
+    EXPECT_FALSE(decoder.read(&packet));
+
+    for (auto pulse: doorbell(1, 2)) {
+        decoder.apply(pulse);
+    }
+    EXPECT_TRUE(decoder.read(&packet));
+    EXPECT_EQ(1, packet.id);
+}
+
+TEST(OOKDecoderTest, repeat_header_is_a_packet_by_itself) {
+    DoorbellDecoder decoder;
+    decoder.apply(Pulse(true, 2000));
+    decoder.apply(Pulse(false, 4000));
+
+    DoorbellPacket packet;
+    EXPECT_TRUE(decoder.read(&packet));
+    EXPECT_TRUE(packet.repeat);
+}
+
+TEST(OOKDecoderTest, accepted_pulse_range_covers_header_and_bits) {
+    EXPECT_EQ(150, uint16_t(DoorbellDecoder::minPulse));
+    EXPECT_EQ(4100, uint16_t(DoorbellDecoder::maxPulse));
+}
+
+}
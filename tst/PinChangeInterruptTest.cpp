@@ -136,4 +136,21 @@ TEST(PinChangeInterruptOnChangeTest, binds_to_interrupt_when_used_as_handler) {
     EXPECT_EQ(1, app.changes);
 }
 
+TEST(PinChangeInterruptTest, records_event_when_invoking_handler) {
+	PinChangeInterrupt<MockPCINTInfo, (1 << 3)> intForBit3;
+	PINC.apply(~(PINC0 | PINC1 | PINC2 | PINC3 | PINC4 | PINC5 | PINC6));
+	intForBit3.interruptOnChange();
+	Logging::Impl::events.clear();
+
+	PINC3.set();
+	PinChangeVector<MockPCINTInfo, (1 << 3)>::wrap([] {});
+
+	uint8_t id;
+	uint16_t arg;
+	EXPECT_TRUE(Logging::Impl::events.read(id, arg));
+	EXPECT_EQ(uint8_t(Logging::Event::PIN_CHANGE), id);
+	EXPECT_EQ(0x0808, arg);
+	EXPECT_FALSE(Logging::Impl::events.read(id, arg));
+}
+
 }
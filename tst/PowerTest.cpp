@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
 #include "HAL/Atmel/Power.hpp"
+#include "HAL/Atmel/TWI.hpp"
 #include "Time/RealTimer.hpp"
 #include "Mocks.hpp"
 #include "invoke.hpp"
 #include "Tasks/TaskState.hpp"
 
+extern std::function<void(volatile void *)> onRegister8_change;
+
 namespace PowerTest {
 
 using namespace HAL::Atmel;
@@ -27,12 +30,17 @@ TEST(PowerTest, sleep_adjusts_timer) {
 TEST(PowerTest, sleep_returns_if_woken_up_by_non_watchdog) {
     MockRealTimer rt;
     auto power = Power<MockRealTimer>(rt);
-    onSleep_cpu = nullptr;  // don't invoke watchdog when waking up.
+    onSleep_cpu = [&rt] {
+        // don't invoke watchdog when waking up, so the first sleep's calibration times out after 64ms.
+        rt.advance(1_ms);
+    };
     power.sleepFor(Milliseconds(1000), SleepMode::POWER_DOWN);
 
-    // The code requested to sleep for 512ms, but since we don't know when during that time we
-    // woke up, we return half that time.
+    // The code requested to sleep for 512ms (the longest interval that fits in what's left after calibrating),
+    // but since we don't know when during that time we woke up, we return half that time.
     EXPECT_EQ(256, rt.slept);
+
+    onSleep_cpu = nullptr;
 }
 
 TEST(PowerTest, sleep_with_IDLE_does_not_adjust_timer) {
@@ -97,10 +105,16 @@ TEST(PowerTest, unscheduled_deadline_allows_unrestricted_sleep) {
     auto power = Power<MockRealTimer>(rt);
     auto d1 = deadline(rt, 1_ms);
     d1.cancel();
+    onSleep_cpu = [&rt] {
+        // only the real timer wakes us up, so the first sleep's calibration times out.
+        rt.advance(1_ms);
+    };
 
     power.sleepUntil(d1, SleepMode::POWER_DOWN);
 
     EXPECT_EQ(4096, rt.slept);
+
+    onSleep_cpu = nullptr;
 }
 
 TEST(PowerTest, sleepUntilTasks_should_sleep_for_lowest_task_duration) {
@@ -216,4 +230,423 @@ TEST(PowerTest, should_not_sleep_on_delays_less_than_16ms) {
     EXPECT_FALSE(haveSlept);
 }
 
+/**
+ * Simulates a watchdog running at [percent] of its nominal speed: IDLE sleep advances the real timer,
+ * deeper sleep modes only advance [realTime], since the real timer is stopped there.
+ */
+template <typename power_t>
+struct SkewedWatchdog {
+    MockRealTimer &rt;
+    power_t &power;
+    uint32_t percent;
+    uint32_t realTime = 0;
+
+    uint8_t getWdp() {
+        const uint8_t v = WDTCSR.get();
+        return (v & 7) | (((v >> 5) & 1) << 3);
+    }
+
+    void operator()() {
+        const uint64_t us = (uint64_t(16000) << getWdp()) * percent / 100;
+        if (SM1.isSet()) {
+            realTime += us / 1000;
+        } else {
+            rt.c += us * (F_CPU >> MockRealTimer::prescalerPower2) / 1000000;
+        }
+        invoke<Int_WDT_>(power);
+    }
+};
+
+TEST(PowerTest, calibrate_measures_slow_watchdog) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    SkewedWatchdog<decltype(power)> wdt = { rt, power, 125 };
+    onSleep_cpu = [&wdt] { wdt(); };
+
+    EXPECT_EQ(256, power.getWatchdogPeriod());
+    EXPECT_TRUE(power.calibrate());
+    EXPECT_NEAR(320, power.getWatchdogPeriod(), 2);
+
+    power.sleepFor(Milliseconds(10000), SleepMode::POWER_DOWN);
+    EXPECT_NEAR(wdt.realTime, rt.slept, 40);
+    EXPECT_LE(wdt.realTime, 10040);
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, calibrate_measures_fast_watchdog) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    SkewedWatchdog<decltype(power)> wdt = { rt, power, 90 };
+    onSleep_cpu = [&wdt] { wdt(); };
+
+    EXPECT_TRUE(power.calibrate());
+    EXPECT_NEAR(230, power.getWatchdogPeriod(), 2);
+
+    power.sleepFor(Milliseconds(10000), SleepMode::POWER_DOWN);
+    EXPECT_NEAR(wdt.realTime, rt.slept, 40);
+    EXPECT_GE(wdt.realTime, 9900);
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, first_sleep_calibrates_skewed_watchdog) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    SkewedWatchdog<decltype(power)> wdt = { rt, power, 125 };
+    onSleep_cpu = [&wdt] { wdt(); };
+
+    power.sleepFor(Milliseconds(10000), SleepMode::POWER_DOWN);
+    EXPECT_NEAR(320, power.getWatchdogPeriod(), 2);
+    EXPECT_NEAR(wdt.realTime, rt.slept, 40);
+
+    // calibration has spent 2 slow watchdog intervals in IDLE, which are taken off the requested time
+    const uint32_t calibrationMs = toMillisOn<MockRealTimer>(Counts(rt.counts())).getValue();
+    EXPECT_NEAR(40, calibrationMs, 2);
+    EXPECT_NEAR(10000 - calibrationMs, rt.slept, 40);
+    EXPECT_NEAR(10000, wdt.realTime + calibrationMs, 40);
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, calibrate_fails_if_watchdog_does_not_fire) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    onSleep_cpu = [&rt] { rt.advance(1_ms); };
+
+    EXPECT_FALSE(power.calibrate());
+    EXPECT_EQ(256, power.getWatchdogPeriod());
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, supply_voltage_change_triggers_recalibration) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    SkewedWatchdog<decltype(power)> wdt = { rt, power, 110 };
+    onSleep_cpu = [&wdt] { wdt(); };
+
+    power.onSupplyVoltage(3300);
+    power.sleepFor(Milliseconds(1000), SleepMode::POWER_DOWN);
+    EXPECT_NEAR(281, power.getWatchdogPeriod(), 2);
+
+    wdt.percent = 120;
+    power.onSupplyVoltage(3250); // small change, no recalibration
+    power.sleepFor(Milliseconds(1000), SleepMode::POWER_DOWN);
+    EXPECT_NEAR(281, power.getWatchdogPeriod(), 2);
+
+    power.onSupplyVoltage(3000);
+    power.sleepFor(Milliseconds(1000), SleepMode::POWER_DOWN);
+    EXPECT_NEAR(307, power.getWatchdogPeriod(), 2);
+
+    onSleep_cpu = nullptr;
+}
+
+/**
+ * Simulates timer 0 during IDLE sleep: it counts at the prescaler in TCCR0B until its overflow or comparator B
+ * interrupt (if enabled) wakes the CPU up, or until another interrupt fires at [otherInterruptAt] F_CPU cycles.
+ */
+template <typename rt_t, typename power_t>
+struct SimulatedTimer0 {
+    rt_t &rt;
+    power_t &power;
+    uint32_t cycles = 0;
+    uint32_t interrupts = 0;
+    uint32_t otherInterruptAt = 0xFFFFFFFF;
+
+    static uint16_t prescaler() {
+        using namespace HAL::Atmel::Registers;
+        switch (TCCR0B.get() & 0x07) {
+        case 1: return 1;
+        case 2: return 8;
+        case 3: return 64;
+        case 4: return 256;
+        case 5: return 1024;
+        default: return 0;
+        }
+    }
+
+    void operator()() {
+        using namespace HAL::Atmel::Registers;
+        for (;;) {
+            cycles += prescaler();
+            const uint8_t next = TCNT0.get() + 1;
+            TCNT0.set(next);
+            if (next == 0 && TOIE0.isSet()) {
+                interrupts++;
+                invoke<Int_TIMER0_OVF_>(rt);
+                return;
+            }
+            if (next == OCR0B.get() && OCIE0B.isSet()) {
+                interrupts++;
+                invoke<Int_TIMER0_COMPB_>(power);
+                return;
+            }
+            if (cycles >= otherInterruptAt) {
+                otherInterruptAt = 0xFFFFFFFF;
+                interrupts++;
+                return;
+            }
+        }
+    }
+
+    uint32_t millis() const {
+        return cycles / (F_CPU / 1000);
+    }
+};
+
+/**
+ * Resets timer 0, and makes its interrupt flags read as cleared, since SimulatedTimer0 invokes the handlers
+ * directly. Software only writes those flags to clear them.
+ */
+void resetTimer0() {
+    using namespace HAL::Atmel::Registers;
+    onRegister8_change = [] (volatile void *address) {
+        if (address == &TIFR0_t::reg() && TIFR0.get() != 0) {
+            TIFR0.set(0);
+        }
+    };
+    TIMSK0.set(0);
+    TIFR0.set(0);
+    TCNT0.set(0);
+    OCR0B.set(0);
+}
+
+template <typename rt_t, typename power_t>
+uint32_t wakeupsPerSecond(rt_t &rt, power_t &power) {
+    uint32_t wakeups = 0;
+    const uint32_t end = rt.millis().getValue() + 1000;
+    while (rt.millis().getValue() < end) {
+        power.sleepFor(100_ms, SleepMode::IDLE);
+        wakeups++;
+    }
+    return wakeups;
+}
+
+TEST(PowerTest, tickless_idle_sleep_reduces_wakeups) {
+    using namespace HAL::Atmel::Registers;
+    resetTimer0();
+    auto timer = Timer0::withPrescaler<64>::inNormalMode();
+    auto rt = realTimer(timer);
+    auto ticking = Power(rt);
+    auto tickless = Power<decltype(rt), true>(rt);
+    SimulatedTimer0<decltype(rt), decltype(tickless)> sim = { rt, tickless };
+    onSleep_cpu = [&sim] { sim(); };
+
+    const uint32_t tickingWakeups = wakeupsPerSecond(rt, ticking);
+    const uint32_t tickingInterrupts = sim.interrupts;
+
+    sim.interrupts = 0;
+    const uint32_t ticklessWakeups = wakeupsPerSecond(rt, tickless);
+
+    std::cout << "Wakeups per second: " << tickingWakeups << " ticking, " << ticklessWakeups << " tickless. "
+              << "Timer interrupts: " << tickingInterrupts << " vs. " << sim.interrupts << std::endl;
+    EXPECT_EQ(977, tickingWakeups);
+    EXPECT_EQ(977, tickingInterrupts);
+    EXPECT_EQ(10, ticklessWakeups);
+    EXPECT_EQ(70, sim.interrupts); // one compare match per 16ms slow timer period, and one at each deadline
+    EXPECT_NEAR(sim.millis(), rt.millis().getValue(), 1);
+
+    EXPECT_EQ(3, TCCR0B.get() & 0x07); // prescaler 64
+    EXPECT_TRUE(TOIE0.isSet());
+    EXPECT_TRUE(OCIE0B.isCleared());
+
+    onRegister8_change = nullptr;
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, tickless_idle_sleep_is_ended_by_other_interrupts) {
+    using namespace HAL::Atmel::Registers;
+    resetTimer0();
+    auto timer = Timer0::withPrescaler<64>::inNormalMode();
+    auto rt = realTimer(timer);
+    auto power = Power<decltype(rt), true>(rt);
+    SimulatedTimer0<decltype(rt), decltype(power)> sim = { rt, power };
+    sim.otherInterruptAt = F_CPU / 1000 * 30;
+    onSleep_cpu = [&sim] { sim(); };
+
+    EXPECT_TRUE(power.sleepFor(100_ms, SleepMode::IDLE));
+    EXPECT_EQ(30, sim.millis());
+    EXPECT_NEAR(30, rt.millis().getValue(), 1);
+
+    EXPECT_FALSE(power.sleepFor(5_ms, SleepMode::IDLE));
+    EXPECT_EQ(35, sim.millis());
+    EXPECT_NEAR(35, rt.millis().getValue(), 1);
+    EXPECT_TRUE(TOIE0.isSet());
+
+    onRegister8_change = nullptr;
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, sleepUntilTasks_should_sleep_until_latest_wakeup_satisfying_all_tasks) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    onSleep_cpu = [&power] {
+        // simulate always waking up by watchdog
+        invoke<Int_WDT_>(power);
+    };
+
+    TaskState t1[3] = {
+      TaskState::busy(1000_ms, SleepMode::POWER_DOWN).withSlack(100_ms),
+      TaskState::busy(1050_ms, SleepMode::POWER_DOWN).withSlack(100_ms),
+      TaskState::idle() };
+    power.sleepUntilTasks(t1, 3);
+    EXPECT_EQ(1088, rt.slept); // nearest multiple of 16 below 1100ms
+    rt.slept = 0;
+
+    TaskState t2[2] = {
+      TaskState::busy(1000_ms, SleepMode::POWER_DOWN).withSlack(500_ms),
+      TaskState::busy(1200_ms, SleepMode::POWER_DOWN) };
+    power.sleepUntilTasks(t2, 2);
+    EXPECT_EQ(1200, rt.slept);
+    rt.slept = 0;
+
+    power.sleepUntilTasks(t2[0], t2[1], TaskState::idle());
+    EXPECT_EQ(1200, rt.slept);
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, sleepUntilTasks_should_not_sleep_if_all_tasks_are_idle) {
+    MockRealTimer rt;
+    auto power = Power<MockRealTimer>(rt);
+    bool haveSlept = false;
+    onSleep_cpu = [&haveSlept] { haveSlept = true; };
+
+    TaskState t[2] = { TaskState::idle(), TaskState::idle() };
+    power.sleepUntilTasks(t, 2);
+    EXPECT_FALSE(haveSlept);
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, power_down_uses_timed_BOD_disable_sequence) {
+    using namespace HAL::Atmel::Registers;
+    MCUCR.set(0);
+    std::vector<uint8_t> writes;
+    onRegister8_change = [&writes] (volatile void *address) {
+        if (address == &MCUCR_t::reg()) {
+            writes.push_back(MCUCR.get());
+        }
+    };
+    bool enabled = false;
+    onSleep_cpu = [&enabled] { enabled = SE.isSet(); };
+
+    HAL::Atmel::Impl::sleep(SleepMode::IDLE);
+    EXPECT_TRUE(writes.empty());
+
+    HAL::Atmel::Impl::sleep(SleepMode::POWER_DOWN);
+    EXPECT_TRUE(enabled);
+    EXPECT_EQ((std::vector<uint8_t> { 0x60, 0x40 }), writes); // BODS | BODSE, then BODS only
+
+    onRegister8_change = nullptr;
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, sleep_stops_clock_of_idle_ADC_and_TWI) {
+    using namespace HAL::Atmel::Registers;
+    PRR.set(0);
+    ADCSRA.set(0);
+    ADEN.set();
+    TWCR.set(0);
+    TWEN.set();
+    TWIE.set();
+    TWSR.set(0xF8);
+    uint8_t prr = 0;
+    bool adcEnabled = true;
+    onSleep_cpu = [&prr, &adcEnabled] {
+        prr = PRR.get();
+        adcEnabled = ADEN.isSet();
+    };
+
+    HAL::Atmel::Impl::sleep(SleepMode::IDLE);
+    EXPECT_EQ((PRR_t(PRADC | PRTWI)).get(), prr);
+    EXPECT_FALSE(adcEnabled);
+    EXPECT_EQ(0, PRR.get());
+    EXPECT_TRUE(ADEN.isSet());
+    EXPECT_TRUE(TWEN.isSet());
+    EXPECT_TRUE(TWIE.isSet());
+
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, sleep_keeps_clock_of_busy_ADC_and_TWI) {
+    using namespace HAL::Atmel::Registers;
+    PRR.set(0);
+    ADCSRA.set(0);
+    ADEN.set();
+    ADSC.set();
+    TWCR.set(0);
+    TWEN.set();
+    TWSR.set(0x08); // start condition transmitted
+    HAL::Atmel::Impl::TWIBus::transceiving = true;
+    uint8_t prr = 0xFF;
+    onSleep_cpu = [&prr] { prr = PRR.get(); };
+
+    HAL::Atmel::Impl::sleep(SleepMode::IDLE);
+    EXPECT_EQ(0, prr);
+    EXPECT_TRUE(ADEN.isSet());
+
+    ADCSRA.set(0);
+    TWCR.set(0);
+    HAL::Atmel::Impl::TWIBus::transceiving = false;
+    onSleep_cpu = nullptr;
+}
+
+TEST(PowerTest, sleep_keeps_clock_of_TWI_while_a_byte_is_on_the_wire) {
+    using namespace HAL::Atmel::Registers;
+    PRR.set(0);
+    ADCSRA.set(0);
+    TWCR.set(0);
+    TWEN.set();
+    TWIE.set();
+    TWSR.set(0xF8); // TWINT is cleared while the address or data byte is being shifted out
+    HAL::Atmel::Impl::TWIBus::transceiving = true;
+    uint8_t prr = 0xFF;
+    onSleep_cpu = [&prr] { prr = PRR.get(); };
+
+    HAL::Atmel::Impl::sleep(SleepMode::IDLE);
+    EXPECT_EQ((PRR_t(PRADC)).get(), prr);
+    EXPECT_TRUE(TWEN.isSet());
+
+    HAL::Atmel::Impl::TWIBus::transceiving = false;
+    HAL::Atmel::Impl::sleep(SleepMode::IDLE);
+    EXPECT_EQ((PRR_t(PRADC | PRTWI)).get(), prr);
+
+    TWCR.set(0);
+    onSleep_cpu = nullptr;
+}
+
+struct ADCSensor {
+    void onADC() {}
+    typedef On<ADCSensor, Int_ADC_, &ADCSensor::onADC> Handlers;
+};
+
+struct UsesADCAndTimer0 {
+    ADCSensor sensor;
+    void onTimer0() {}
+    typedef Delegate<UsesADCAndTimer0, ADCSensor, &UsesADCAndTimer0::sensor,
+            On<UsesADCAndTimer0, Int_TIMER0_OVF_, &UsesADCAndTimer0::onTimer0>> Handlers;
+};
+
+TEST(PowerTest, gateUnusedPeripherals_stops_clock_of_peripherals_without_handlers_or_drivers) {
+    using namespace HAL::Atmel::Registers;
+    PRR.set(0);
+    ADCSRA.set(0);
+    UCSR0B.set(0);
+    TWCR.set(0);
+    TCCR0B.set(0);
+    TCCR1B.set(0);
+    TCCR2B.set(0);
+    ASSR.set(0);
+    SPCR.set(0);
+    SPE.set(); // e.g. by SPIMaster, which doesn't use interrupts
+
+    gateUnusedPeripherals<UsesADCAndTimer0::Handlers>();
+    EXPECT_EQ((PRR_t(PRUSART0 | PRTWI | PRTIM1 | PRTIM2)).get(), PRR.get());
+
+    SPCR.set(0);
+    PRR.set(0);
+}
+
 }
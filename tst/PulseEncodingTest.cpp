@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "Serial/PulseCounter.hpp"
+#include "FS20/FS20Decoder.hpp"
+#include "Mocks.hpp"
+#include "RecordedPulses.hpp"
+#include "invoke.hpp"
+
+namespace PulseEncodingTest {
+
+using namespace Serial;
+using RecordedPulses::fs20;
+using RecordedPulses::visonic;
+using namespace Mocks;
+
+// A NEC IR remote, as recorded on prescaler 256 (see IRDecoderTest)
+const uint16_t nec[] = { 49926 ,553 ,274 ,27 ,28 ,27 ,98 ,27 ,27 ,27 ,98 ,27 ,98 ,27 ,97 ,26 ,98 ,27 ,28 ,26 ,98 ,26 ,
+        28 ,27 ,98 ,26 ,28 ,27 ,28 ,26 ,28 ,27 ,28 ,29 ,95 ,27 ,98 ,27 ,98 ,27 ,98 ,26 ,28 ,27 ,29 ,29 ,25 ,30 ,95 ,26 ,
+        28 ,27 ,28 ,29 ,25 ,30 ,25 ,29 ,95 ,27 ,98 ,27 ,98 ,26 ,27 ,30 ,25 ,29 ,2542 ,553 ,135 ,26 };
+
+/** Returns how many pulses of [seq] fit into a 64-byte fifo, given that each write needs encoding_t::maxSize. */
+template <typename encoding_t, typename value_t = uint16_t>
+uint8_t pulsesFitting(const uint16_t *seq, uint8_t length) {
+    Fifo<64> fifo;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < length && fifo.fastGetSpace() >= encoding_t::maxSize; i++) {
+        encoding_t::fastWrite(fifo, value_t(seq[i]), (i % 2) == 0);
+        count++;
+    }
+    return count;
+}
+
+TEST(PulseEncodingTest, compact_stores_short_pulses_in_one_byte_and_escapes_long_ones) {
+    typedef PulseEncoding::Compact<4> encoding_t;
+    Fifo<16> fifo;
+    EXPECT_EQ(1, encoding_t::fastWrite(fifo, uint16_t(800), true));
+    EXPECT_EQ(1, encoding_t::fastWrite(fifo, uint16_t(3), false));
+    EXPECT_EQ(1, encoding_t::fastWrite(fifo, uint16_t(0), true));
+    EXPECT_EQ(3, encoding_t::fastWrite(fifo, uint16_t(18587), false));
+    EXPECT_EQ(6, fifo.getSize());
+
+    uint16_t length;
+    bool high;
+    EXPECT_TRUE(encoding_t::read(fifo, length, high));
+    EXPECT_TRUE(high);
+    EXPECT_EQ(800, length);
+    EXPECT_TRUE(encoding_t::read(fifo, length, high));
+    EXPECT_FALSE(high);
+    EXPECT_EQ(16, length);  // rounded up to 1 unit, since 0 would be a timeout
+    EXPECT_TRUE(encoding_t::read(fifo, length, high));
+    EXPECT_TRUE(high);
+    EXPECT_EQ(0, length);
+    EXPECT_TRUE(encoding_t::read(fifo, length, high));
+    EXPECT_FALSE(high);
+    EXPECT_EQ(18587, length);
+    EXPECT_FALSE(encoding_t::read(fifo, length, high));
+}
+
+TEST(PulseEncodingTest, unit_is_chosen_to_fit_the_longest_pulse_in_one_byte) {
+    EXPECT_EQ(0, PulseEncoding::unitPower2For(126));
+    EXPECT_EQ(1, PulseEncoding::unitPower2For(127));
+    EXPECT_EQ(1, PulseEncoding::unitPower2For(240));
+    EXPECT_EQ(4, PulseEncoding::unitPower2For(1253));
+}
+
+TEST(PulseEncodingTest, compact_fits_at_least_twice_the_pulses_of_recorded_traces) {
+    // DHT22 on an 8-bit timer with prescaler 8: 2 sync pulses, then 40 bits of a 71us low and a 30us or 70us high.
+    uint16_t dht22[82] = { 160, 160 };
+    for (uint8_t i = 2; i < 82; i += 2) {
+        dht22[i] = 142;
+        dht22[i + 1] = (i % 6 == 0) ? 140 : 60;
+    }
+
+    EXPECT_EQ(21, (pulsesFitting<PulseEncoding::Wide>(fs20, 120)));
+    EXPECT_EQ(62, (pulsesFitting<PulseEncoding::Compact<4>>(fs20, 120)));
+
+    EXPECT_EQ(21, (pulsesFitting<PulseEncoding::Wide>(visonic, 77)));
+    EXPECT_EQ(62, (pulsesFitting<PulseEncoding::Compact<4>>(visonic, 77)));
+
+    EXPECT_EQ(21, (pulsesFitting<PulseEncoding::Wide>(nec, 72)));
+    EXPECT_EQ(56, (pulsesFitting<PulseEncoding::Compact<0>>(nec, 72)));
+
+    EXPECT_EQ(31, (pulsesFitting<PulseEncoding::Wide, uint8_t>(dht22, 82)));
+    EXPECT_EQ(62, (pulsesFitting<PulseEncoding::Compact<1>, uint8_t>(dht22, 82)));
+}
+
+TEST(PulseEncodingTest, fs20_decoder_works_unchanged_on_compact_pulse_counter) {
+    typedef MockComparator<uint16_t, 3> MockComparator;
+    MockComparator comp;
+    MockPin pin;
+    pin.high = true;
+    auto pc = pulseCounter<32, PulseEncoding::Compact<4>>(comp, pin);
+    FS20::FS20Decoder<decltype(pc)> decoder;
+
+    for (uint16_t d: fs20) {
+        comp.value += d;
+        pin.high = !pin.high;
+        invoke<MockPin::INT>(pc);
+        pc.onMax(4, [&] (auto pulse) { decoder.apply(pulse); });
+    }
+    comp.advanceToTargetAndInvoke(pc);
+    pc.onMax(4, [&] (auto pulse) { decoder.apply(pulse); });
+
+    FS20::FS20Packet pkt;
+    EXPECT_TRUE(decoder.read(&pkt));
+    EXPECT_EQ(27, pkt.houseCodeHi);
+    EXPECT_EQ(255, pkt.houseCodeLo);
+    EXPECT_EQ(0, pkt.address);
+    EXPECT_EQ(0, pkt.command);
+}
+
+}
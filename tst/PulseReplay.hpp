@@ -0,0 +1,165 @@
+#ifndef PULSEREPLAY_HPP_
+#define PULSEREPLAY_HPP_
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Serial/Pulse.hpp"
+#include "Mocks.hpp"
+
+/**
+ * Replays pulse traces, as recorded by Serial::PulseRecorder or generated by tools/pulsetrace.py, into decoders.
+ */
+namespace PulseReplay {
+
+using namespace Serial;
+
+struct Trace {
+    uint8_t mhz = 0;
+    uint8_t prescalerPower2 = 0;
+    uint8_t unitPower2 = 0;
+    std::vector<Pulse> pulses;
+
+    /** Parses a trace, skipping anything before its header. Returns an empty trace (mhz 0) if there's no header. */
+    static Trace parse(const std::vector<uint8_t> &data) {
+        Trace trace;
+        size_t pos = 0;
+        while (pos + 5 <= data.size() && !(data[pos] == 'P' && data[pos + 1] == 'T')) {
+            pos++;
+        }
+        if (pos + 5 > data.size()) {
+            return trace;
+        }
+        trace.mhz = data[pos + 2];
+        trace.prescalerPower2 = data[pos + 3];
+        trace.unitPower2 = data[pos + 4];
+        pos += 5;
+        while (pos < data.size()) {
+            const uint8_t b = data[pos++];
+            const bool high = (b & 0x80) != 0;
+            uint16_t length;
+            if ((b & 0x7F) == 0x7F) {
+                if (pos + 2 > data.size()) {
+                    break;
+                }
+                length = data[pos] | (data[pos + 1] << 8);
+                pos += 2;
+            } else {
+                length = uint16_t((b & 0x7F) << trace.unitPower2);
+            }
+            trace.pulses.push_back(Pulse(high, length));
+        }
+        return trace;
+    }
+
+    static Trace load(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        const std::vector<uint8_t> data { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+        return parse(data);
+    }
+
+    /** Returns the pulses, in counts of a timer running at [prescalerPower2] on this F_CPU. */
+    std::vector<Pulse> pulsesOn(uint8_t toPrescalerPower2) const {
+        const uint64_t from = (uint64_t(mhz) * 1000000) >> prescalerPower2;
+        const uint64_t to = uint64_t(F_CPU) >> toPrescalerPower2;
+        std::vector<Pulse> result;
+        for (const Pulse &pulse: pulses) {
+            const uint64_t length = (pulse.getDuration() * to + from / 2) / from;
+            result.push_back(Pulse(pulse.isHigh(),
+                    (length > 0xFFFF) ? 0xFFFF : (length == 0 && pulse.isDefined()) ? 1 : uint16_t(length)));
+        }
+        return result;
+    }
+};
+
+/**
+ * Stands in for a PulseCounter on a timer with the given prescaler, handing out the pulses of a trace
+ * instead of measuring them.
+ */
+template <uint8_t prescalerPower2 = 3>
+class ReplayPulseCounter {
+    std::vector<Pulse> pulses;
+    size_t pos = 0;
+
+public:
+    typedef uint16_t count_t;
+    typedef Mocks::MockComparator<uint16_t, prescalerPower2> comparator_t;
+    typedef comparator_t Timer;
+
+    ReplayPulseCounter(const Trace &trace): pulses(trace.pulsesOn(prescalerPower2)) {}
+
+    bool hasPulses() const {
+        return pos < pulses.size();
+    }
+
+    template <typename Body>
+    void on(Body body) {
+        while (pos < pulses.size()) {
+            body(pulses[pos++]);
+        }
+    }
+
+    template <typename Body>
+    void onMax(uint8_t maxPulses, Body body) {
+        for (uint8_t i = 0; i < maxPulses && pos < pulses.size(); i++) {
+            body(pulses[pos++]);
+        }
+    }
+
+    void rewind() {
+        pos = 0;
+    }
+
+    size_t size() const {
+        return pulses.size();
+    }
+};
+
+struct Result {
+    size_t pulses = 0;
+    /** Packets that [accept] was true for */
+    size_t decoded = 0;
+    /** Packets that the decoder returned, but [accept] was false for, i.e. false positives */
+    size_t rejected = 0;
+    double nsPerPulse = 0;
+};
+
+/**
+ * Replays the counter's pulses into a new [decoder_t] [rounds] times, and checks every [packet_t] it decodes
+ * with [accept]. Packets are read as soon as they're decoded, so the decoder's fifo never overflows. The counts
+ * are for the first round, the timing averages all of them.
+ */
+template <typename decoder_t, typename packet_t, typename counter_t, typename accept_t>
+Result replay(counter_t &counter, accept_t accept, int rounds = 1) {
+    typedef std::chrono::steady_clock clock;
+    Result result;
+    result.pulses = counter.size();
+    std::chrono::nanoseconds elapsed(0);
+    for (int r = 0; r < rounds; r++) {
+        decoder_t decoder;
+        packet_t packet;
+        counter.rewind();
+        const auto start = clock::now();
+        counter.on([&] (const Pulse &pulse) {
+            decoder.apply(pulse);
+            while (decoder.read(&packet)) {
+                if (r > 0) {
+                    continue;
+                } else if (accept(packet)) {
+                    result.decoded++;
+                } else {
+                    result.rejected++;
+                }
+            }
+        });
+        elapsed += clock::now() - start;
+    }
+    result.nsPerPulse = double(elapsed.count()) / rounds / result.pulses;
+    return result;
+}
+
+}
+
+#endif /* PULSEREPLAY_HPP_ */
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include "Serial/PulseRecorder.hpp"
+#include "FS20/FS20Decoder.hpp"
+#include "IR/IRDecoder.hpp"
+#include "PulseReplay.hpp"
+
+namespace PulseReplayTest {
+
+using namespace Serial;
+using namespace PulseReplay;
+
+typedef ReplayPulseCounter<3> Counter;
+typedef FS20::FS20Decoder<Counter> FS20_t;
+typedef IRDecoder_NEC<Counter> NEC_t;
+
+std::vector<uint8_t> readAll(Fifo<64> &fifo) {
+    std::vector<uint8_t> result;
+    uint8_t b;
+    while (fifo.read(&b)) {
+        result.push_back(b);
+    }
+    return result;
+}
+
+void print(const char *name, const Result &result) {
+    std::cout << name << ": " << result.pulses << " pulses, " << result.decoded << " decoded, " << result.rejected
+              << " rejected, " << result.nsPerPulse << " ns per pulse" << std::endl;
+}
+
+bool isSyntheticFS20(const FS20::FS20Packet &packet) {
+    return packet.houseCodeHi == 0x1B && packet.houseCodeLo == 0x2C && packet.address < 20 && packet.command == 0x10;
+}
+
+bool isSyntheticNEC(const IRCode &code) {
+    return code.getType() == IRType::Repeat || (code.getCommand() >> 16) == 0x10EF;
+}
+
+TEST(PulseReplayTest, recorder_writes_header_and_compact_pulses_and_marks_dropped_pulses) {
+    Counter counter((Trace()));
+    Fifo<64> fifo;
+    auto recorder = pulseRecorder<4>(counter, fifo);
+    EXPECT_TRUE(recorder.start());
+    recorder.apply(Pulse(true, 800));
+    recorder.apply(Pulse(false, 5000));
+    EXPECT_EQ(std::vector<uint8_t>({ 'P', 'T', 16, 3, 4, 0x80 | 50, 127, 0x88, 0x13 }), readAll(fifo));
+
+    while (fifo.getSpace() > 0) {
+        fifo.write(uint8_t(0));
+    }
+    recorder.apply(Pulse(true, 800));
+    recorder.apply(Pulse(false, 800));
+    EXPECT_EQ(2, recorder.getDroppedPulses());
+    readAll(fifo);
+    recorder.apply(Pulse(true, 800));
+    EXPECT_EQ(std::vector<uint8_t>({ 0, 0x80 | 50 }), readAll(fifo));
+}
+
+TEST(PulseReplayTest, recorded_trace_replays_on_another_prescaler) {
+    Fifo<64> fifo;
+    PulseRecorder<Fifo<64>, Mocks::MockComparator<uint16_t, 3>, 4> recorder(fifo);
+    recorder.start();
+    recorder.apply(Pulse(true, 800));
+    recorder.apply(Pulse::empty());
+    recorder.apply(Pulse(false, 5000));
+
+    const Trace trace = Trace::parse(readAll(fifo));
+    EXPECT_EQ(3u, trace.pulses.size());
+    ReplayPulseCounter<6> counter(trace);
+    std::vector<Pulse> replayed;
+    counter.onMax(2, [&] (const Pulse &pulse) { replayed.push_back(pulse); });
+    EXPECT_TRUE(counter.hasPulses());
+    counter.on([&] (const Pulse &pulse) { replayed.push_back(pulse); });
+    EXPECT_FALSE(counter.hasPulses());
+
+    ASSERT_EQ(3u, replayed.size());
+    EXPECT_TRUE(replayed[0].isHigh());
+    EXPECT_EQ(100, replayed[0].getDuration());
+    EXPECT_TRUE(replayed[1].isEmpty());
+    EXPECT_FALSE(replayed[2].isHigh());
+    EXPECT_EQ(625, replayed[2].getDuration());
+}
+
+TEST(PulseReplayTest, fs20_decoder_on_noisy_trace) {
+    const Trace trace = Trace::load("tst/traces/fs20-noisy.pulses");
+    ASSERT_EQ(16, trace.mhz) << "Run the tests from the repository root";
+    Counter counter(trace);
+
+    const Result result = replay<FS20_t, FS20::FS20Packet>(counter, isSyntheticFS20, 20);
+    print("fs20-noisy", result);
+    EXPECT_EQ(17, result.decoded);
+    EXPECT_EQ(0, result.rejected);
+}
+
+TEST(PulseReplayTest, nec_decoder_on_noisy_trace) {
+    const Trace trace = Trace::load("tst/traces/nec-noisy.pulses");
+    ASSERT_EQ(16, trace.mhz) << "Run the tests from the repository root";
+    Counter counter(trace);
+
+    const Result result = replay<NEC_t, IRCode>(counter, isSyntheticNEC, 20);
+    print("nec-noisy", result);
+    EXPECT_EQ(17 + 40, result.decoded);
+    EXPECT_EQ(0, result.rejected);
+}
+
+TEST(PulseReplayTest, decoders_on_noise_only) {
+    const Trace trace = Trace::load("tst/traces/noise.pulses");
+    ASSERT_EQ(16, trace.mhz) << "Run the tests from the repository root";
+    Counter counter(trace);
+
+    const Result fs20 = replay<FS20_t, FS20::FS20Packet>(counter, isSyntheticFS20, 20);
+    print("noise, fs20", fs20);
+    EXPECT_EQ(0, fs20.decoded + fs20.rejected);
+
+    const Result nec = replay<NEC_t, IRCode>(counter, isSyntheticNEC, 20);
+    print("noise, nec", nec);
+    EXPECT_EQ(0, nec.decoded + nec.rejected);
+}
+
+}
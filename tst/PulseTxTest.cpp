@@ -7,8 +7,13 @@
 
 #include "Serial/PulseTx.hpp"
 #include "Serial/SimplePulseTx.hpp"
+#include "Serial/RenderedPulseSource.hpp"
+#include "FS20/FS20Packet.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
 #include "invoke.hpp"
+#include "Mocks.hpp"
 
 namespace PulseTxTest {
 
@@ -175,4 +180,141 @@ TEST(PulseTxTest, multiple_pulses_on_comparators_pwm_pin_can_be_sent) {
     // no further assertions, we'll leave the pin at the comparator's mercy for now.
 }
 
+TEST(PulseTxTest, rendered_source_merges_pulses_of_same_level_and_ends_each_chunk) {
+    MockComparator comparator;
+    MockSoftwarePin pin;
+    SimplePulseTxSource<> source(false);
+    RenderedPulseSource<decltype(source)> rendered(source);
+    auto tx = pulseTx(comparator, pin, rendered);
+
+    source.append(Pulse(true, 50));
+    source.append(Pulse(true, 20));
+    source.append(Pulse(false, 42));
+    EXPECT_TRUE(rendered.render());
+    source.append(Pulse(true, 10));
+    EXPECT_TRUE(rendered.render()); // still has the first chunk, so doesn't take the new pulse yet
+    tx.sendFromSource();
+
+    EXPECT_TRUE(pin.high);
+    EXPECT_EQ(75, comparator.target);
+    invoke<MockComparator::INT>(tx);
+    EXPECT_FALSE(pin.high);
+    EXPECT_EQ(117, comparator.target);
+    invoke<MockComparator::INT>(tx);
+    EXPECT_FALSE(comparator.isInterruptOn);
+    EXPECT_FALSE(rendered.hasPulses());
+
+    EXPECT_TRUE(rendered.render());
+    tx.sendFromSource();
+    EXPECT_TRUE(pin.high);
+    EXPECT_EQ(15, comparator.target);
+}
+
+TEST(PulseTxTest, rendered_source_drops_chunks_that_dont_fit) {
+    SimplePulseTxSource<> source(false);
+    RenderedPulseSource<decltype(source), 2> rendered(source);
+
+    source.append(Pulse(true, 50));
+    source.append(Pulse(false, 20));
+    source.append(Pulse(true, 42));
+    EXPECT_FALSE(rendered.render());
+    EXPECT_EQ(1, rendered.getDroppedChunks());
+    EXPECT_TRUE(rendered.getNextPulse().isEmpty());
+
+    source.append(Pulse(true, 50));
+    EXPECT_TRUE(rendered.render());
+    EXPECT_EQ(50, rendered.getNextPulse().getDuration());
+}
+
+/** Records how long after the start of the comparator interrupt each edge happens. */
+struct MockTimedPin {
+    typedef std::chrono::steady_clock clock;
+
+    clock::time_point interruptStart;
+    std::vector<double> delays;
+    bool high = false;
+
+    void setHigh(bool h) {
+        delays.push_back(std::chrono::duration<double, std::nano>(clock::now() - interruptStart).count());
+        high = h;
+    }
+
+    /** Returns the delay that [fraction] of the edges were faster than, in ns. The worst few are mostly host noise. */
+    double percentile(double fraction) {
+        std::sort(delays.begin(), delays.end());
+        return delays[size_t(fraction * (delays.size() - 1))];
+    }
+};
+
+template <typename tx_t>
+std::vector<uint8_t> sendAndRecordTargets(tx_t &tx, MockComparator &comparator, MockTimedPin &pin) {
+    std::vector<uint8_t> targets;
+    pin.interruptStart = MockTimedPin::clock::now();
+    tx.sendFromSource();
+    while (comparator.isInterruptOn) {
+        targets.push_back(comparator.target);
+        pin.interruptStart = MockTimedPin::clock::now();
+        invoke<MockComparator::INT>(tx);
+    }
+    return targets;
+}
+
+TEST(PulseTxTest, rendered_fs20_chunk_has_same_timing_with_less_work_in_interrupt) {
+    typedef FS20::FS20Packet::SerialFormat<Mocks::MockComparator<uint16_t, 3>> format_t;
+    const FS20::FS20Packet packet(0x1B, 0x2C, 3, 0x10, 0);
+    SerialConfig config = format_t::serialconfig;
+
+    Fifo<32> directData, renderedData;
+    ChunkedFifo directFifo(directData), renderedFifo(renderedData);
+    ChunkPulseSource directSource(directFifo), chunkSource(renderedFifo);
+    RenderedPulseSource<ChunkPulseSource> renderedSource(chunkSource);
+    MockComparator directComparator, renderedComparator;
+    MockTimedPin directPin, renderedPin;
+    auto directTx = pulseTx(directComparator, directPin, directSource);
+    auto renderedTx = pulseTx(renderedComparator, renderedPin, renderedSource);
+
+    for (int i = 0; i < 1000; i++) {
+        directFifo.write(uintptr_t(&config), &packet);
+        renderedFifo.write(uintptr_t(&config), &packet);
+        EXPECT_TRUE(renderedSource.render());
+
+        const auto directTargets = sendAndRecordTargets(directTx, directComparator, directPin);
+        const auto renderedTargets = sendAndRecordTargets(renderedTx, renderedComparator, renderedPin);
+        ASSERT_EQ(142, directTargets.size());
+        ASSERT_EQ(directTargets, renderedTargets);
+    }
+    EXPECT_EQ(0, renderedSource.getDroppedChunks());
+
+    std::cout << "ns from interrupt to edge, ChunkPulseSource: median " << directPin.percentile(0.5)
+              << ", 99.9% " << directPin.percentile(0.999)
+              << "; RenderedPulseSource: median " << renderedPin.percentile(0.5)
+              << ", 99.9% " << renderedPin.percentile(0.999) << std::endl;
+}
+
+TEST(PulseTxTest, rendered_source_fits_fs20_frame_with_commandExt) {
+    typedef FS20::FS20Packet::SerialFormat<Mocks::MockComparator<uint16_t, 3>> format_t;
+    const FS20::FS20Packet packet(0x1B, 0x2C, 3, 0x30, 0x0A); // bit 5 of the command adds commandExt
+    ASSERT_TRUE(packet.hasCommandExt());
+    SerialConfig config = format_t::serialconfig;
+
+    Fifo<32> directData, renderedData;
+    ChunkedFifo directFifo(directData), renderedFifo(renderedData);
+    ChunkPulseSource directSource(directFifo), chunkSource(renderedFifo);
+    RenderedPulseSource<ChunkPulseSource> renderedSource(chunkSource);
+    MockComparator directComparator, renderedComparator;
+    MockTimedPin directPin, renderedPin;
+    auto directTx = pulseTx(directComparator, directPin, directSource);
+    auto renderedTx = pulseTx(renderedComparator, renderedPin, renderedSource);
+
+    directFifo.write(uintptr_t(&config), &packet);
+    renderedFifo.write(uintptr_t(&config), &packet);
+    EXPECT_TRUE(renderedSource.render());
+
+    const auto directTargets = sendAndRecordTargets(directTx, directComparator, directPin);
+    const auto renderedTargets = sendAndRecordTargets(renderedTx, renderedComparator, renderedPin);
+    EXPECT_EQ(160, directTargets.size());
+    EXPECT_EQ(directTargets, renderedTargets);
+    EXPECT_EQ(0, renderedSource.getDroppedChunks());
+}
+
 }
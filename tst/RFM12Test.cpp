@@ -268,4 +268,27 @@ TEST(RFM12Test, can_send_multiple_queued_ook_packets) {
     EXPECT_TRUE(spi.tx.read(FB(184,0,130,13,130,221))); // Empty TX reg, Idle, Turn on RX
 }
 
+TEST(RFM12Test, rfm12_renders_fs20_packets_while_queueing_them) {
+    MockSPIMaster spi;
+    MockSSPin ss_pin;
+    MockIntPin int_pin;
+    MockComparator comp;
+    auto rfm = rfm12(spi, ss_pin, int_pin, comp, RFM12Band::_868Mhz);
+
+    FS20Packet packet(0,0,0,0,0);
+    EXPECT_TRUE(rfm.write_fs20(packet));
+    EXPECT_EQ(RFM12Mode::SENDING_OOK, rfm.getMode());
+    EXPECT_EQ(143, rfm.getPulses()); // 142 pulses, and the empty one ending the packet
+    EXPECT_TRUE(rfm.write_fs20(packet));
+    EXPECT_EQ(uint8_t(2 * 143), rfm.getPulses());
+    EXPECT_FALSE(rfm.write_fs20(packet)); // both rendered packets are still waiting to be sent
+
+    for (int pulse = 0; pulse < 142; pulse++) {
+        invoke<MockComparator::INT>(rfm);
+    }
+    EXPECT_EQ(RFM12Mode::SENDING_OOK, rfm.getMode()); // sending the second packet
+    EXPECT_EQ(uint8_t(2 * 143), rfm.getPulses()); // which the interrupt didn't have to render
+    EXPECT_TRUE(rfm.write_fs20(packet));
+}
+
 }
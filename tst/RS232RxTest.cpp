@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "Serial/RS232Rx.hpp"
+#include "HAL/Atmel/Device.hpp"
+#include "Mocks.hpp"
+#include "invoke.hpp"
+
+namespace RS232RxTest {
+
+using namespace Mocks;
+using namespace Serial;
+
+typedef MockComparator<uint16_t, 3> Comparator;
+
+/**
+ * Drives a pin with 8N1 serial data, one timer count at a time. Every edge is moved by up to [jitter] of a bit,
+ * the sender's clock is off by [clockError], and interrupts on the pin start up to 2 counts after the edge.
+ */
+struct Line {
+    struct Edge {
+        uint32_t time;
+        bool high;
+    };
+
+    std::vector<Edge> edges;
+    uint32_t end = 0;
+
+    Line(const std::vector<uint8_t> &bytes, double bitLength, double jitter, double clockError, uint32_t seed) {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<double> offset(-jitter * bitLength, jitter * bitLength);
+        const double sentBit = bitLength * (1 + clockError);
+        double t = 3 * bitLength;
+        for (uint8_t b: bytes) {
+            const uint16_t frame = 0x200 | (b << 1); // start bit, data LSB first, stop bit
+            for (uint8_t i = 0; i < 10; i++) {
+                edges.push_back({ uint32_t(t + ((i == 0) ? 0 : offset(random))), ((frame >> i) & 1) != 0 });
+                t += sentBit;
+            }
+            t += bitLength / 3;  // some idle time between bytes
+        }
+        end = uint32_t(t + 3 * bitLength);
+    }
+
+    template <typename rx_t>
+    void run(rx_t &rx, MockPin &pin, Comparator &comparator) {
+        pin.high = true;
+        size_t next = 0;
+        uint32_t pinInterruptAt = UINT32_MAX;
+        for (uint32_t t = 0; t < end; t++) {
+            comparator.value = uint16_t(t);
+            while (next < edges.size() && edges[next].time <= t) {
+                if (pin.high && !edges[next].high && pin.isInterruptOn) {
+                    pinInterruptAt = t + (next % 3);
+                }
+                pin.high = edges[next].high;
+                next++;
+            }
+            if (t == pinInterruptAt) {
+                pinInterruptAt = UINT32_MAX;
+                if (pin.isInterruptOn) {
+                    invoke<MockPin::INT>(rx);
+                }
+            }
+            if (comparator.isInterruptOn && comparator.target == comparator.value) {
+                invoke<Comparator::INT>(rx);
+            }
+        }
+    }
+};
+
+template <uint32_t baudrate>
+void expectReceived(double jitter, double clockError) {
+    const std::vector<uint8_t> sent = { 0x00, 0xFF, 0x55, 0xAA, 'G', 'P', 'S', 0x01, 0x80, 0x7E, 0x3C, 0x42 };
+    MockPin pin;
+    Comparator comparator;
+    auto rx = Serial::Impl::RS232Rx<MockPin, Comparator, baudrate, 32>(pin, comparator);
+    EXPECT_FALSE(pin.isOutput);
+    EXPECT_TRUE(pin.isInterruptOn);
+
+    Line line(sent, double(F_CPU >> 3) / baudrate, jitter, clockError, baudrate);
+    line.run(rx, pin, comparator);
+
+    std::vector<uint8_t> received;
+    uint8_t b;
+    while (rx.read(&b)) {
+        received.push_back(b);
+    }
+    EXPECT_EQ(sent, received);
+    EXPECT_EQ(0, rx.getFramingErrors());
+    EXPECT_TRUE(pin.isInterruptOn);
+    EXPECT_FALSE(comparator.isInterruptOn);
+}
+
+TEST(RS232RxTest, receives_9600_baud_with_jitter) {
+    expectReceived<9600>(0.15, 0.02);
+}
+
+TEST(RS232RxTest, receives_19200_baud_with_jitter) {
+    expectReceived<19200>(0.15, -0.02);
+}
+
+TEST(RS232RxTest, receives_38400_baud_with_jitter) {
+    expectReceived<38400>(0.15, 0.02);
+}
+
+TEST(RS232RxTest, receives_consecutive_bytes_on_pin_change_interrupt_pin_sharing_its_port) {
+    using namespace HAL::Atmel;
+    using namespace HAL::Atmel::Registers;
+    PCICR.set(0);
+    PCMSK1.set(0);
+    PINC.set(0xFF);
+    // Another pin on port C keeps PCINT1 enabled while RS232Rx masks its own pin during a byte.
+    auto other = PinPC1::withInterrupt();
+    other.interruptOnChange();
+    auto pin = PinPC0::withInterrupt();
+    Comparator comparator;
+    auto rx = Serial::Impl::RS232Rx<decltype(pin), Comparator, 9600, 32>(pin, comparator);
+
+    const std::vector<uint8_t> sent = { 'G', 'P', 'S' };
+    Line line(sent, double(F_CPU >> 3) / 9600, 0, 0, 1);
+    size_t next = 0;
+    for (uint32_t t = 0; t < line.end; t++) {
+        comparator.value = uint16_t(t);
+        while (next < line.edges.size() && line.edges[next].time <= t) {
+            const uint8_t before = PINC.get();
+            PINC.set(line.edges[next].high ? (before | PINC0) : (before & ~PINC0));
+            if (PINC.get() != before && (PCMSK1.get() & PCINT8)) {
+                invoke<Int_PCINT1_>(rx);
+            }
+            next++;
+        }
+        if (comparator.isInterruptOn && comparator.target == comparator.value) {
+            invoke<Comparator::INT>(rx);
+        }
+    }
+
+    std::vector<uint8_t> received;
+    uint8_t b;
+    while (rx.read(&b)) {
+        received.push_back(b);
+    }
+    EXPECT_EQ(sent, received);
+    EXPECT_EQ(0, rx.getFramingErrors());
+    EXPECT_TRUE(PCMSK1.get() & PCINT8);
+
+    other.interruptOff();
+    pin.interruptOff();
+}
+
+TEST(RS232RxTest, ignores_spikes_and_drops_bytes_with_low_stop_bit) {
+    MockPin pin;
+    Comparator comparator;
+    auto rx = RS232Rx<9600>(pin, comparator);
+    pin.high = true;
+
+    // a spike shorter than half a bit
+    pin.high = false;
+    invoke<MockPin::INT>(rx);
+    pin.high = true;
+    comparator.advanceToTargetAndInvoke(rx);
+    EXPECT_TRUE(pin.isInterruptOn);
+    EXPECT_FALSE(comparator.isInterruptOn);
+
+    // a break, i.e. low for longer than a byte
+    pin.high = false;
+    invoke<MockPin::INT>(rx);
+    for (int i = 0; i < 10; i++) {
+        comparator.advanceToTargetAndInvoke(rx);
+    }
+    EXPECT_EQ(1, rx.getFramingErrors());
+    EXPECT_TRUE(pin.isInterruptOn);
+    uint8_t b;
+    EXPECT_FALSE(rx.read(&b));
+}
+
+}
@@ -1,4 +1,5 @@
 #include "gtest/gtest.h"
+#include <vector>
 #include "Serial/RS232Tx.hpp"
 #include "Mocks.hpp"
 #include "invoke.hpp"
@@ -178,12 +179,96 @@ TEST(RS232Tx, should_send_0xFF_out) {
 	EXPECT_FALSE(pin.comparator.isInterruptOn);
 }
 
-TEST(RS232Tx, should_send_0xCC_out) {
+/** A comparator that also models its output compare latch, so the actual waveform on the pin can be checked. */
+struct WaveformComparator: public MockComparator<uint8_t> {
+	bool latch = true;
+
+	void match() {
+		switch (mode) {
+		case NonPWMOutputMode::toggle_on_match: latch = !latch; break;
+		case NonPWMOutputMode::high_on_match: latch = true; break;
+		case NonPWMOutputMode::low_on_match: latch = false; break;
+		default: break;
+		}
+	}
+
+	void applyOutput() {
+		MockComparator<uint8_t>::applyOutput();
+		match();
+	}
+};
+
+struct WaveformPin: public MockPin {
+	typedef WaveformComparator comparator_t;
+	comparator_t comparator;
+
+	comparator_t &timerComparator() { return comparator; }
+
+	bool line() {
+		return (comparator.mode == NonPWMOutputMode::disconnected) ? high : comparator.latch;
+	}
+};
+
+/** Sends [bytes] back to back, and returns the level on the pin during each bit. */
+std::vector<bool> send(const std::vector<uint8_t> &bytes) {
+	WaveformPin pin;
+	auto rs = Serial::Impl::RS232Tx<WaveformPin,57600,32>(pin);
+	const uint8_t bitLength = rs.bitLength;
+	for (uint8_t b: bytes) {
+		rs.write(b);
+	}
+
+	std::vector<bool> bits;
+	while (pin.comparator.isInterruptOn) {
+		const bool level = pin.line();
+		const uint8_t length = pin.comparator.target - pin.comparator.value;
+		EXPECT_EQ(0, length % bitLength);
+		for (uint8_t i = 0; i < length / bitLength; i++) {
+			bits.push_back(level);
+		}
+		pin.comparator.value = pin.comparator.target;
+		pin.comparator.match();
+		invoke<WaveformComparator::INT>(rs);
+	}
+	EXPECT_TRUE(pin.line());
+	return bits;
+}
+
+std::vector<bool> frames(const std::vector<uint8_t> &bytes) {
+	std::vector<bool> bits;
+	for (uint8_t b: bytes) {
+		bits.push_back(false);
+		for (uint8_t i = 0; i < 8; i++) {
+			bits.push_back(((b >> i) & 1) != 0);
+		}
+		bits.push_back(true);
+	}
+	return bits;
+}
 
+TEST(RS232Tx, should_send_0xCC_out) {
+	EXPECT_EQ(frames({ 0xCC }), send({ 0xCC }));
 }
 
 TEST(RS232Tx, should_send_0x55_out) {
+	EXPECT_EQ(frames({ 0x55 }), send({ 0x55 }));
+}
+
+TEST(RS232Tx, should_send_every_byte_value_bit_exact) {
+	for (uint16_t b = 0; b < 256; b++) {
+		EXPECT_EQ(frames({ uint8_t(b) }), send({ uint8_t(b) })) << "byte " << b;
+	}
+}
+
+TEST(RS232Tx, should_send_consecutive_bytes_back_to_back) {
+	const std::vector<uint8_t> bytes = { 0x00, 0xFF, 0x00, 0x80, 0x01, 0xF0, 0x0F, 0xCC, 0x55, 0xAA, 0x7E };
+	EXPECT_EQ(frames(bytes), send(bytes));
+}
 
+TEST(RS232Tx, run_table_splits_runs_longer_than_4_bits) {
+	// 0x00 is 9 low bits (start bit and data) and the stop bit: 4, split, 4, split, 1, 1
+	EXPECT_EQ(0x9B2Cu, Serial::Impl::RS232TxRuns::encode(0x00));
+	EXPECT_EQ(Serial::Impl::RS232TxRuns::encode(0x5A), Serial::Impl::RS232TxRuns::read(0x5A));
 }
 
 }
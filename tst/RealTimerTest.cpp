@@ -16,6 +16,7 @@ struct MockTimer {
     typedef uint8_t value_t;
     typedef uint8_t prescaler_t;
     uint8_t value = 0;
+    bool overflow = false;
     static constexpr uint8_t maximum = 255;
     static constexpr uint8_t maximumPower2 = 8;
     static constexpr uint8_t prescaler = 0;
@@ -25,6 +26,10 @@ struct MockTimer {
         return value;
     }
 
+    bool isOverflow() {
+        return overflow;
+    }
+
     void interruptOnOverflowOn() {
 
     }
@@ -51,6 +56,25 @@ TEST(RealTimerTest, timer_callback_increments_time) {
     EXPECT_EQ(4096_us, rt.micros());
 }
 
+MockTimer t4;
+TEST(RealTimerTest, counts_include_an_overflow_whose_interrupt_is_still_pending) {
+    auto rt = realTimer(t4);
+    invoke<MockTimer::INT>(rt);
+
+    t4.value = 3;
+    t4.overflow = true;
+    EXPECT_EQ(Counts(512 + 3), rt.counts());
+    EXPECT_EQ(8_ms, rt.millis());
+
+    t4.value = 255; // the overflow happened after reading the timer
+    EXPECT_EQ(Counts(256 + 255), rt.counts());
+
+    invoke<MockTimer::INT>(rt);
+    t4.value = 3;
+    t4.overflow = false;
+    EXPECT_EQ(Counts(512 + 3), rt.counts());
+}
+
 bool waited2;
 void wait2() {
     waited2 = true;
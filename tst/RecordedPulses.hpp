@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Pulse lengths as received from real transmitters, starting with a high pulse, for feeding into pulse counters
+ * and decoders.
+ */
+namespace RecordedPulses {
+
+/** The start of an FS20 packet, as recorded on prescaler 8 (see FS20DecoderTest) */
+const uint16_t fs20[] = { 965, 638, 892, 694, 855, 740, 827, 767, 806, 782, 793, 792, 782, 805, 776, 815, 764, 826,
+        756, 824, 756, 829, 753, 835, 1139, 1239, 748, 834, 745, 839, 745, 841, 1133, 1243, 1132, 1244, 740, 844, 1127,
+        1247, 1129, 1246, 744, 842, 1129, 1243, 1130, 1246, 1129, 1253, 1125, 1241, 1132, 1245, 1129, 1247, 1130, 1245,
+        1129, 1249, 741, 841, 739, 845, 743, 840, 738, 848, 738, 847, 737, 846, 736, 849, 734, 845, 738, 852, 734, 847,
+        734, 846, 738, 847, 739, 843, 737, 846, 738, 847, 739, 844, 739, 847, 734, 851, 737, 842, 741, 849, 734, 842,
+        1127, 1249, 740, 844, 739, 847, 738, 843, 740, 844, 738, 845, 1127, 1252, 735, 18587 };
+
+/** A Visonic packet, as recorded on prescaler 8 (see VisonicDecoderTest) */
+const uint16_t visonic[] = { 426,258,268,231,905,702,1659,1625,821,821,1598,884,1552,1716,744,1696,765,1667,774,874,1558,
+        928,1515,1735,724,1707,749,893,1536,1720,743,1692,764,1678,777,871,1563,1706,744,892,1540,1726,736,906,1526,1729,
+        736,911,1523,943,1506,1735,724,912,1527,934,1509,961,1490,956,1484,1752,715,1710,744,887,1544,926,1522,1736,725,
+        1695,757,897,1551,1710,743 };
+
+}
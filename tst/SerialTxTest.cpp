@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
+#include <chrono>
 #include "Serial/SerialTx.hpp"
 #include "Serial/RS232.hpp"
+#include "FS20/FS20Packet.hpp"
 #include "invoke.hpp"
+#include "Mocks.hpp"
 
 namespace SerialTxTest {
 
@@ -245,4 +248,117 @@ TEST(SerialTxTest, can_send_rs232_8n1_data) {
     EXPECT_FALSE(tx.isSending());
 }
 
+template <SerialBitOrder bitOrder>
+struct TestFormat {
+    static constexpr uint8_t prefix[] = { 0b100 };
+    static constexpr uint8_t postfix[] = { 0 };
+    static constexpr SerialConfig serialconfig = { false, prefix, 3, {false, 10}, {true, 20}, {true, 30}, {false, 40}, SerialParity::EVEN, bitOrder, postfix, 1 };
+};
+
+template <SerialBitOrder bitOrder> constexpr uint8_t TestFormat<bitOrder>::prefix[];
+template <SerialBitOrder bitOrder> constexpr uint8_t TestFormat<bitOrder>::postfix[];
+template <SerialBitOrder bitOrder> constexpr SerialConfig TestFormat<bitOrder>::serialconfig;
+
+TEST(SerialTxTest, static_source_transmits_all_config_parts) {
+    typedef TestFormat<SerialBitOrder::LSB_FIRST> format_t;
+    Fifo<32> data;
+    ChunkedFifo fifo(data);
+    SerialConfig config = format_t::serialconfig;
+    StaticChunkPulseSource<StaticSerialConfig<format_t>> source = { fifo };
+    MockComparator comparator;
+    MockPin pin;
+    auto tx = pulseTx(comparator, pin, source);
+
+    fifo.write(uint8_t(42), uint8_t(24));
+    fifo.write(uint8_t(43));
+    transmitTestBytes(config, 42, 24, fifo, comparator, pin, tx);
+    transmitTestBytes(config, 43, 0, fifo, comparator, pin, tx);
+}
+
+TEST(SerialTxTest, static_source_transmits_msb_first_and_skips_chunk_header) {
+    typedef TestFormat<SerialBitOrder::MSB_FIRST> format_t;
+    Fifo<32> data;
+    ChunkedFifo fifo(data);
+    SerialConfig config = format_t::serialconfig;
+    StaticChunkPulseSource<StaticSerialConfig<format_t>, 1> source = { fifo };
+    MockComparator comparator;
+    MockPin pin;
+    auto tx = pulseTx(comparator, pin, source);
+
+    fifo.write(uint8_t(99), uint8_t(42), uint8_t(24));
+    transmitTestBytes(config, 42, 24, fifo, comparator, pin, tx);
+
+    tx.sendFromSource();
+    EXPECT_FALSE(tx.isSending());
+}
+
+struct MockTimer {
+    typedef uint16_t value_t;
+
+    template <uint32_t usecs, typename return_t = value_t>
+    static constexpr return_t microseconds2counts() {
+        return usecs * 2;
+    }
+};
+
+TEST(SerialTxTest, static_source_can_send_rs232_8n1_data) {
+    typedef RS232::_8n1<MockTimer, 9600> format_t;
+    Fifo<32> data;
+    ChunkedFifo fifo(data);
+    StaticChunkPulseSource<StaticSerialConfig<format_t>> source = { fifo };
+    EXPECT_TRUE(source.isHighOnIdle());
+
+    fifo.write(uint8_t(0b01000010));
+    const bool expected[] = { false, false, true, false, false, false, false, true, false, true };
+    for (bool bit: expected) {
+        const Pulse pulse = source.getNextPulse();
+        EXPECT_EQ(bit, pulse.isHigh());
+        EXPECT_EQ(uint16_t(format_t::bit_length), pulse.getDuration());
+    }
+    EXPECT_TRUE(source.getNextPulse().isEmpty());
+}
+
+TEST(SerialTxTest, static_source_sends_same_fs20_pulses_as_chunk_source_in_less_time) {
+    typedef FS20::FS20Packet::SerialFormat<Mocks::MockComparator<uint16_t, 3>> format_t;
+    typedef std::chrono::steady_clock clock;
+    Fifo<32> dynamicData, staticData;
+    ChunkedFifo dynamicFifo(dynamicData), staticFifo(staticData);
+    SerialConfig config = format_t::serialconfig;
+    ChunkPulseSource dynamicSource = { dynamicFifo };
+    StaticChunkPulseSource<StaticSerialConfig<format_t>> staticSource = { staticFifo };
+    const FS20::FS20Packet packet(0x1B, 0x2C, 3, 0x10, 0);
+
+    std::vector<Pulse> dynamicPulses, staticPulses;
+    clock::duration dynamicTime(0), staticTime(0);
+    for (int round = 0; round < 1000; round++) {
+        dynamicPulses.clear();
+        staticPulses.clear();
+        dynamicFifo.write(uintptr_t(&config), &packet);
+        staticFifo.write(&packet);
+
+        auto start = clock::now();
+        for (Pulse p = dynamicSource.getNextPulse(); p.isDefined(); p = dynamicSource.getNextPulse()) {
+            dynamicPulses.push_back(p);
+        }
+        dynamicTime += clock::now() - start;
+
+        start = clock::now();
+        for (Pulse p = staticSource.getNextPulse(); p.isDefined(); p = staticSource.getNextPulse()) {
+            staticPulses.push_back(p);
+        }
+        staticTime += clock::now() - start;
+    }
+
+    EXPECT_EQ(142, staticPulses.size());
+    ASSERT_EQ(dynamicPulses.size(), staticPulses.size());
+    for (size_t i = 0; i < staticPulses.size(); i++) {
+        EXPECT_EQ(dynamicPulses[i].isHigh(), staticPulses[i].isHigh());
+        EXPECT_EQ(dynamicPulses[i].getDuration(), staticPulses[i].getDuration());
+    }
+
+    const double n = 1000.0 * staticPulses.size();
+    std::cout << "ns per pulse, ChunkPulseSource: " << std::chrono::duration<double, std::nano>(dynamicTime).count() / n
+              << ", StaticChunkPulseSource: " << std::chrono::duration<double, std::nano>(staticTime).count() / n << std::endl;
+}
+
 }
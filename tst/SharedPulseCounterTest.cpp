@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "Serial/SharedPulseCounter.hpp"
+#include "HAL/Atmel/Device.hpp"
+#include "FS20/FS20Decoder.hpp"
+#include "Mocks.hpp"
+#include "RecordedPulses.hpp"
+#include "invoke.hpp"
+
+namespace SharedPulseCounterTest {
+
+using namespace Serial;
+using RecordedPulses::fs20;
+using namespace HAL::Atmel;
+using namespace Mocks;
+
+typedef MockRealTimerPrescaled<3> MockRealTimer8;
+
+template <typename int_t>
+struct MockPinOn: public MockPin {
+    typedef int_t INT;
+};
+
+typedef MockPinOn<Int_INT0_> Pin0;
+typedef MockPinOn<Int_INT1_> Pin1;
+typedef MockPinOn<Int_PCINT0_> Pin2;
+
+template <typename pin_t, typename counter_t>
+void toggleAt(MockRealTimer8 &rt, uint32_t time, pin_t &pin, counter_t &counter) {
+    rt.c = time;
+    pin.high = !pin.high;
+    invoke<typename pin_t::INT>(counter);
+}
+
+TEST(SharedPulseCounterTest, pulses_are_timestamped_from_real_timer_into_each_pins_own_fifo) {
+    MockRealTimer8 rt;
+    rt.c = 1000;
+    Pin0 pin0;
+    Pin1 pin1;
+    auto pc = sharedPulseCounter<16>(rt, pin0, pin1);
+    EXPECT_FALSE(pin0.isOutput);
+    EXPECT_TRUE(pin0.isInterruptOn);
+    EXPECT_TRUE(pin1.isInterruptOn);
+
+    toggleAt(rt, 1100, pin0, pc);
+    toggleAt(rt, 1150, pin1, pc);
+    toggleAt(rt, 1300, pin0, pc);
+
+    uint16_t durations[2] = {};
+    bool high[2] = {};
+    uint8_t count = 0;
+    pc.channel<0>().onMax(5, [&] (auto pulse) { high[count] = pulse.isHigh(); durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(2, count);
+    EXPECT_FALSE(high[0]);
+    EXPECT_EQ(100, durations[0]);
+    EXPECT_TRUE(high[1]);
+    EXPECT_EQ(200, durations[1]);
+
+    count = 0;
+    pc.channel<1>().onMax(5, [&] (auto pulse) { durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(150, durations[0]);
+}
+
+TEST(SharedPulseCounterTest, timeout_is_detected_lazily_once_per_idle_period_and_long_pulses_saturate) {
+    MockRealTimer8 rt;
+    rt.c = 0xFFFFFF00;  // counts wrap around during the test
+    Pin0 pin0;
+    auto pc = sharedPulseCounter<16>(rt, pin0);
+    auto &ch = pc.channel<0>();
+
+    rt.c += 0xFFFF;
+    EXPECT_FALSE(ch.hasPulses());
+    rt.c += 1;
+    EXPECT_TRUE(ch.hasPulses());
+
+    uint8_t count = 0;
+    uint16_t duration = 1;
+    ch.onMax(5, [&] (auto pulse) { count++; duration = pulse.getDuration(); });
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(0, duration);
+
+    rt.c += 0x20000;
+    EXPECT_FALSE(ch.hasPulses());
+
+    toggleAt(rt, rt.c, pin0, pc);
+    ch.on([&] (auto pulse) { duration = pulse.getDuration(); });
+    EXPECT_EQ(0xFFFF, duration);
+}
+
+TEST(SharedPulseCounterTest, full_fifo_on_one_pin_does_not_affect_the_others) {
+    MockRealTimer8 rt;
+    Pin0 pin0;
+    Pin1 pin1;
+    auto pc = sharedPulseCounter<8>(rt, pin0, pin1);
+    for (uint32_t t = 10; t <= 50; t += 10) {
+        toggleAt(rt, t, pin0, pc);
+    }
+    toggleAt(rt, 60, pin1, pc);
+
+    uint8_t count = 0;
+    pc.channel<0>().onMax(10, [&] (auto pulse) { count++; });
+    EXPECT_EQ(2, count);
+    count = 0;
+    pc.channel<1>().onMax(10, [&] (auto pulse) { count++; });
+    EXPECT_EQ(1, count);
+}
+
+TEST(SharedPulseCounterTest, compact_encoding_fits_three_times_the_pulses_in_the_fifo) {
+    MockRealTimer8 rt;
+    Pin0 pin0;
+    pin0.high = true;
+    auto pc = sharedPulseCounter<8, PulseEncoding::Compact<4>>(rt, pin0);
+    for (uint32_t t = 160; t <= 960; t += 160) {
+        toggleAt(rt, t, pin0, pc);
+    }
+    EXPECT_EQ(0, pc.channel<0>().getOverflows());
+
+    uint16_t durations[6] = {};
+    bool high[6] = {};
+    uint8_t count = 0;
+    pc.channel<0>().onMax(10, [&] (auto pulse) { high[count] = pulse.isHigh(); durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(6, count);
+    for (uint8_t i = 0; i < 6; i++) {
+        EXPECT_EQ(160, durations[i]);
+        EXPECT_EQ(i % 2 == 0, high[i]);
+    }
+}
+
+TEST(SharedPulseCounterTest, two_pin_change_interrupt_pins_on_the_same_port_each_count_their_own_pulses) {
+    using namespace HAL::Atmel::Registers;
+    PCICR.set(0);
+    PCMSK0.set(0);
+    PINB.set(0);
+    MockRealTimer8 rt;
+    rt.c = 1000;
+    auto pinB0 = PinPB0::withInterrupt();
+    auto pinB4 = PinPB4::withInterrupt();
+    auto pc = sharedPulseCounter<16>(rt, pinB0, pinB4);
+    EXPECT_EQ(PCMSK0_t(PCINT0 | PCINT4).get(), PCMSK0.get());
+
+    // Both pins share the PCINT0 vector, which is invoked for every edge on either of them.
+    auto edgeAt = [&] (uint32_t time, uint8_t bit) {
+        rt.c = time;
+        PINB.set(PINB.get() ^ bit);
+        invoke<Int_PCINT0_>(pc);
+    };
+    edgeAt(1100, 1 << 0);
+    edgeAt(1150, 1 << 4);
+    edgeAt(1300, 1 << 0);
+    edgeAt(1450, 1 << 4);
+    edgeAt(1500, 1 << 4);
+
+    uint16_t durations[3] = {};
+    bool high[3] = {};
+    uint8_t count = 0;
+    pc.channel<0>().onMax(5, [&] (auto pulse) { high[count] = pulse.isHigh(); durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(2, count);
+    EXPECT_FALSE(high[0]);
+    EXPECT_EQ(100, durations[0]);
+    EXPECT_TRUE(high[1]);
+    EXPECT_EQ(200, durations[1]);
+
+    count = 0;
+    pc.channel<1>().onMax(5, [&] (auto pulse) { high[count] = pulse.isHigh(); durations[count++] = pulse.getDuration(); });
+    EXPECT_EQ(3, count);
+    EXPECT_FALSE(high[0]);
+    EXPECT_EQ(150, durations[0]);
+    EXPECT_TRUE(high[1]);
+    EXPECT_EQ(300, durations[1]);
+    EXPECT_FALSE(high[2]);
+    EXPECT_EQ(50, durations[2]);
+
+    pc.pause();
+    EXPECT_EQ(0, PCMSK0.get());
+}
+
+TEST(SharedPulseCounterTest, three_pins_decode_fs20_concurrently) {
+    MockRealTimer8 rt;
+    Pin0 pin0;
+    Pin1 pin1;
+    Pin2 pin2;
+    pin0.high = pin1.high = pin2.high = true;
+    auto pc = sharedPulseCounter<32>(rt, pin0, pin1, pin2);
+    auto &ch0 = pc.channel<0>();
+    auto &ch1 = pc.channel<1>();
+    auto &ch2 = pc.channel<2>();
+    FS20::FS20Decoder<typename std::remove_reference<decltype(ch0)>::type> decoder0;
+    FS20::FS20Decoder<typename std::remove_reference<decltype(ch1)>::type> decoder1;
+    FS20::FS20Decoder<typename std::remove_reference<decltype(ch2)>::type> decoder2;
+
+    constexpr uint8_t n = sizeof(fs20) / sizeof(fs20[0]);
+
+    // Each pin receives the same packet, started at a different time, so their edges interleave.
+    uint32_t edge[3] = { 50000 + fs20[0], 50333 + fs20[0], 50517 + fs20[0] };
+    uint8_t pos[3] = { 0, 0, 0 };
+    rt.c = 50000;
+    while (pos[0] < n || pos[1] < n || pos[2] < n) {
+        uint8_t p = 3;
+        for (uint8_t i = 0; i < 3; i++) {
+            if (pos[i] < n && (p == 3 || edge[i] < edge[p])) {
+                p = i;
+            }
+        }
+        const uint32_t t = edge[p];
+        if (++pos[p] < n) {
+            edge[p] += fs20[pos[p]];
+        }
+        switch (p) {
+            case 0: toggleAt(rt, t, pin0, pc); break;
+            case 1: toggleAt(rt, t, pin1, pc); break;
+            case 2: toggleAt(rt, t, pin2, pc); break;
+        }
+        ch0.onMax(4, [&] (auto pulse) { decoder0.apply(pulse); });
+        ch1.onMax(4, [&] (auto pulse) { decoder1.apply(pulse); });
+        ch2.onMax(4, [&] (auto pulse) { decoder2.apply(pulse); });
+    }
+    rt.c += 0x10000;
+    ch0.onMax(4, [&] (auto pulse) { decoder0.apply(pulse); });
+    ch1.onMax(4, [&] (auto pulse) { decoder1.apply(pulse); });
+    ch2.onMax(4, [&] (auto pulse) { decoder2.apply(pulse); });
+
+    FS20::FS20Packet pkt0, pkt1, pkt2;
+    EXPECT_TRUE(decoder0.read(&pkt0));
+    EXPECT_TRUE(decoder1.read(&pkt1));
+    EXPECT_TRUE(decoder2.read(&pkt2));
+    EXPECT_EQ(27, pkt0.houseCodeHi);
+    EXPECT_EQ(255, pkt1.houseCodeLo);
+    EXPECT_EQ(27, pkt2.houseCodeHi);
+    EXPECT_EQ(0, pkt2.command);
+}
+
+}
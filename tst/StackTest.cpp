@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "HAL/Atmel/Stack.hpp"
+#include "Mocks.hpp"
+
+namespace StackTest {
+
+using namespace HAL::Atmel;
+using namespace Mocks;
+
+struct SimulatedRAM {
+    uint8_t ram[256];
+
+    SimulatedRAM() {
+        HAL::Atmel::Impl::paintStack(ram, ram + sizeof(ram));
+        HAL::Atmel::Impl::simulatedStack = { ram, ram + sizeof(ram) };
+    }
+
+    ~SimulatedRAM() {
+        HAL::Atmel::Impl::simulatedStack = { nullptr, nullptr };
+    }
+
+    /** Simulates a call chain that has used [bytes] of stack, growing down from the end of RAM */
+    void use(uint16_t bytes) {
+        for (uint16_t i = 0; i < bytes; i++) {
+            ram[sizeof(ram) - 1 - i] = i;
+        }
+    }
+};
+
+TEST(StackTest, high_water_mark_is_lowest_free_memory_seen) {
+    SimulatedRAM mem;
+    EXPECT_EQ(256, stackHighWater());
+
+    mem.use(40);
+    EXPECT_EQ(216, stackHighWater());
+
+    mem.use(10);    // stack unwound, but the deeper frames stay recorded
+    EXPECT_EQ(216, stackHighWater());
+
+    mem.use(100);
+    EXPECT_EQ(156, stackHighWater());
+}
+
+TEST(StackTest, canary_value_in_a_frame_still_counts_as_used_beyond_it) {
+    SimulatedRAM mem;
+    mem.use(20);
+    mem.ram[256 - 10] = HAL::Atmel::Impl::stackCanary;  // a local that happens to equal the canary
+    EXPECT_EQ(236, stackHighWater());
+}
+
+TEST(StackTest, monitor_reports_periodically) {
+    SimulatedRAM mem;
+    MockRealTimer rt;
+    auto monitor = stackMonitor(rt, 10_s);
+    EXPECT_FALSE(monitor.getTaskState().isIdle());
+    EXPECT_NEAR(10000, monitor.getTaskState().timeLeft().getValue(), 10);
+
+    mem.use(56);
+    monitor.loop();
+    EXPECT_EQ(0xFFFF, monitor.getLowest());
+
+    rt.advance(10_s);
+    monitor.loop();
+    EXPECT_EQ(200, monitor.getLowest());
+}
+
+TEST(StackTest, without_painted_region_reports_nothing_free) {
+    EXPECT_EQ(0, stackHighWater());
+}
+
+}
@@ -25,4 +25,22 @@ TEST(TaskStateTest, should_return_correct_ms_if_deadline_returns_ticks) {
 	EXPECT_EQ(3000000, check2.getValue());
 }
 
+TEST(TaskStateTest, slack_extends_latest_wakeup) {
+	auto state = TaskState::busy(100_ms, SleepMode::POWER_DOWN);
+	EXPECT_EQ(0, state.getSlack());
+	EXPECT_EQ(100, state.latestWakeup());
+
+	auto slack = state.withSlack(50_ms);
+	EXPECT_EQ(100, slack.timeLeft());
+	EXPECT_EQ(50, slack.getSlack());
+	EXPECT_EQ(150, slack.latestWakeup());
+	EXPECT_EQ(SleepMode::POWER_DOWN, slack.getMaxSleepMode());
+}
+
+TEST(TaskStateTest, slack_saturates) {
+	auto state = TaskState(some(Milliseconds(0xFFFFFFF0)), SleepMode::POWER_DOWN).withSlack(100_ms);
+	EXPECT_EQ(0xFFFFFFFF, state.latestWakeup());
+	EXPECT_EQ(0xFFFF, TaskState::busy(100_ms, SleepMode::IDLE).withSlack(100_s).getSlack());
+}
+
 }
@@ -5,10 +5,12 @@
 #include "Tasks/TaskState.hpp"
 #include "Tasks/loop.hpp"
 #include "Tasks/Task.hpp"
+#include "HAL/Atmel/Power.hpp"
 
 namespace TasksLoopTest {
 
 using namespace Mocks;
+using HAL::Atmel::Registers::TCNT1;
 
 struct MockPower {
     bool haveSlept = false;
@@ -78,5 +80,512 @@ TEST(TasksLoopTest, loop_should_invoke_all_tasks_and_then_sleep) {
     EXPECT_TRUE(perHandler.invoked); // now!
 }
 
+/** A real timer that keeps counting while the simulated node sleeps */
+struct SimRealTimer: public MockRealTimerPrescaled<10> {
+    void haveSlept(Milliseconds millis) {
+        c += uint64_t(millis.getValue()) * (F_CPU >> prescalerPower2) / 1000;
+    }
+};
+
+template <typename period_t>
+struct PeriodicSimTask {
+    Periodic<SimRealTimer, period_t> periodic;
+    Milliseconds slack;
+    uint32_t runs = 0;
+
+    PeriodicSimTask(SimRealTimer &rt, Milliseconds s): periodic(rt), slack(s) {}
+
+    TaskState getTaskState() {
+        return TaskState(periodic.timeLeftIfScheduled(), SleepMode::POWER_DOWN).withSlack(slack);
+    }
+
+    void loop() {
+        if (periodic.isNow()) {
+            runs++;
+        }
+    }
+};
+
+struct SimNode {
+    SimRealTimer rt;
+    HAL::Atmel::Impl::Power<SimRealTimer> power = { rt };
+    uint32_t wakeups = 0;
+
+    uint32_t simulateHour(Milliseconds slack) {
+        const uint32_t start = rt.counts();
+        PeriodicSimTask<decltype(10_s)> t1 = { rt, slack };
+        rt.advance(20_ms);
+        PeriodicSimTask<decltype(10_s)> t2 = { rt, slack };
+        rt.advance(300_ms);
+        PeriodicSimTask<decltype(30_s)> t3 = { rt, slack };
+        rt.advance(500_ms);
+        PeriodicSimTask<decltype(60_s)> t4 = { rt, slack };
+        rt.advance(40_ms);
+        PeriodicSimTask<decltype(60_s)> t5 = { rt, slack };
+        rt.advance(700_ms);
+        PeriodicSimTask<decltype(120_s)> t6 = { rt, slack };
+
+        bool slept = false;
+        onSleep_cpu = [this, &slept] {
+            slept = true;
+            invoke<Int_WDT_>(power);
+        };
+
+        const uint32_t hour = toCountsOn<SimRealTimer>(3600_s).getValue();
+        const uint32_t awake = toCountsOn<SimRealTimer>(1_ms).getValue();
+        uint32_t wakeups = 0;
+        while (rt.counts() - start < hour) {
+            loopTasks(power, t1, t2, t3, t4, t5, t6);
+            rt.c += awake;
+            if (slept) {
+                wakeups++;
+                slept = false;
+            }
+        }
+        onSleep_cpu = nullptr;
+
+        EXPECT_NEAR(360, t1.runs, 1);
+        EXPECT_NEAR(360, t2.runs, 1);
+        EXPECT_NEAR(120, t3.runs, 1);
+        EXPECT_NEAR(60, t4.runs, 1);
+        EXPECT_NEAR(60, t5.runs, 1);
+        EXPECT_NEAR(30, t6.runs, 1);
+        return wakeups;
+    }
+};
+
+TEST(TasksLoopTest, slack_coalesces_wakeups_of_periodic_tasks) {
+    const uint32_t separate = SimNode().simulateHour(0_ms);
+    const uint32_t coalesced = SimNode().simulateHour(1000_ms);
+    std::cout << "Wakeups per hour for 6 periodic tasks: " << separate << " without slack, "
+              << coalesced << " with 1s slack." << std::endl;
+
+    EXPECT_NEAR(985, separate, 10);
+    EXPECT_LT(coalesced, 400); // at least one wake-up per 10s remains, for the two most frequent tasks
+}
+
+struct MockDriver {
+    uint8_t received = 0;
+
+    void onInterrupt() {
+        received++;
+    }
+
+    typedef On<MockDriver, Int_INT0_, &MockDriver::onInterrupt> Handlers;
+};
+
+}
+
+namespace HAL { namespace Atmel { namespace InterruptHandlers {
+template <> struct WakesTasks<TasksLoopTest::MockDriver>: public std::true_type {};
+}}}
+
+namespace TasksLoopTest {
+
+// An event-driven task reading from MockDriver
+struct MockReader {
+    TaskState taskState;
+    MockDriver *driver;
+    uint8_t loops = 0;
+
+    typedef MockDriver::Handlers WakeOn;
+
+    TaskState getTaskState() {
+        return taskState;
+    }
+
+    void loop() {
+        loops++;
+    }
+};
+
+TEST(TasksLoopTest, event_driven_task_should_only_loop_when_woken_or_due) {
+    auto power = MockPower();
+    MockDriver driver;
+    MockReader reader = { TaskState::busy(SleepMode::IDLE), &driver };
+    MockTask task = { TaskState::idle() };
+
+    loopTasks(power, reader, task);
+    EXPECT_EQ(0, reader.loops);
+    EXPECT_TRUE(task.haveLooped);
+
+    invoke<Int_INT0_>(driver);
+    loopTasks(power, reader, task);
+    EXPECT_EQ(1, reader.loops);
+
+    loopTasks(power, reader, task);
+    EXPECT_EQ(1, reader.loops);
+
+    reader.taskState = TaskState::busy(0_ms, SleepMode::IDLE);
+    loopTasks(power, reader, task);
+    EXPECT_EQ(2, reader.loops);
+}
+
+TEST(TasksLoopTest, event_driven_tasks_should_all_be_woken_by_shared_handlers) {
+    auto power = MockPower();
+    MockDriver driver;
+    MockReader reader1 = { TaskState::busy(SleepMode::IDLE), &driver };
+    MockReader reader2 = { TaskState::busy(SleepMode::IDLE), &driver };
+
+    invoke<Int_INT0_>(driver);
+    loopTasks(power, reader1, reader2);
+    EXPECT_EQ(1, reader1.loops);
+    EXPECT_EQ(1, reader2.loops);
+}
+
+// A driver that no task wakes on, so its handler doesn't set a wake flag
+struct UnwatchedDriver {
+    void onInterrupt() {}
+
+    typedef On<UnwatchedDriver, Int_INT1_, &UnwatchedDriver::onInterrupt> Handlers;
+};
+
+TEST(TasksLoopTest, only_handlers_of_classes_that_wake_tasks_set_a_wake_flag) {
+    UnwatchedDriver driver;
+    invoke<Int_INT1_>(driver);
+    EXPECT_FALSE(HAL::Atmel::Impl::WakeFlag<UnwatchedDriver>::pending);
+    EXPECT_FALSE(UnwatchedDriver::Handlers::isWakePending());
+    EXPECT_FALSE(UnwatchedDriver::Handlers::hasWakeFlags());
+    EXPECT_TRUE(MockDriver::Handlers::hasWakeFlags());
+}
+
+/** Estimated cycles taken by each kind of loop() and getTaskState() */
+constexpr uint32_t pollCycles = 120;        // e.g. reading a fifo under AtomicScope
+constexpr uint32_t periodicCycles = 40;     // checking a Periodic
+constexpr uint32_t taskStateCycles = 30;
+constexpr uint32_t iterationCycles = 60;    // waking up, and going back to sleep
+
+template <typename handlers_t, bool eventDriven>
+struct WakeOnIf {
+    typedef handlers_t WakeOn;
+};
+
+template <typename handlers_t>
+struct WakeOnIf<handlers_t, false> {};
+
+typedef MockRealTimerPrescaled<6> TickingRealTimer;
+
+struct CycleCounter {
+    uint32_t cycles = 0;
+    uint32_t loops = 0;
+
+    void count(uint32_t c) {
+        cycles += c;
+        loops++;
+    }
+};
+
+template <bool eventDriven>
+struct SimReader: public WakeOnIf<MockDriver::Handlers, eventDriven> {
+    MockDriver *driver;
+    CycleCounter *counter;
+    uint8_t read = 0;
+
+    SimReader(MockDriver &d, CycleCounter &c): driver(&d), counter(&c) {}
+
+    TaskState getTaskState() {
+        counter->cycles += taskStateCycles;
+        return TaskState::busy(SleepMode::IDLE);
+    }
+
+    void loop() {
+        counter->count(pollCycles);
+        read = driver->received;
+    }
+};
+
+template <bool eventDriven, typename period_t>
+struct SimPeriodicTask: public WakeOnIf<NoHandlers<SimPeriodicTask<eventDriven,period_t>>, eventDriven> {
+    Periodic<TickingRealTimer, period_t> periodic;
+    CycleCounter *counter;
+    uint32_t runs = 0;
+
+    SimPeriodicTask(TickingRealTimer &rt, CycleCounter &c): periodic(rt), counter(&c) {}
+
+    TaskState getTaskState() {
+        counter->cycles += taskStateCycles;
+        return TaskState(periodic.timeLeftIfScheduled(), SleepMode::IDLE);
+    }
+
+    void loop() {
+        counter->count(periodicCycles);
+        if (periodic.isNow()) {
+            runs++;
+        }
+    }
+};
+
+// A task that doesn't declare what wakes it, so it's looped on every iteration.
+struct SimLegacyTask {
+    CycleCounter *counter;
+
+    TaskState getTaskState() {
+        counter->cycles += taskStateCycles;
+        return TaskState::busy(SleepMode::IDLE);
+    }
+
+    void loop() {
+        counter->count(periodicCycles);
+    }
+};
+
+/** Sleeps in IDLE, which the real timer's overflow interrupt ends after one tick. */
+struct TickingPower {
+    TickingRealTimer *rt;
+    CycleCounter *counter;
+    uint32_t iterations = 0;
+
+    bool sleepUntilTasks(TaskState *states, uint8_t N) {
+        counter->cycles += iterationCycles;
+        iterations++;
+        rt->c += 256;
+        return true;
+    }
+};
+
+template <bool eventDriven>
+struct SimEventNode {
+    TickingRealTimer rt;
+    CycleCounter counter;
+    TickingPower power = { &rt, &counter };
+    MockDriver radio;
+
+    void simulateTenSeconds() {
+        SimReader<eventDriven> rx = { radio, counter };
+        SimReader<eventDriven> ack = { radio, counter };
+        SimPeriodicTask<eventDriven, decltype(100_ms)> led = { rt, counter };
+        SimPeriodicTask<eventDriven, decltype(1_s)> sensor = { rt, counter };
+        SimPeriodicTask<eventDriven, decltype(10_s)> report = { rt, counter };
+        SimLegacyTask legacy = { &counter };
+
+        const uint32_t end = toCountsOn<TickingRealTimer>(10_s).getValue();
+        const uint32_t packetInterval = toCountsOn<TickingRealTimer>(200_ms).getValue();
+        uint32_t nextPacket = packetInterval;
+        while (rt.counts() < end) {
+            if (rt.counts() >= nextPacket) {
+                invoke<Int_INT0_>(radio);
+                nextPacket += packetInterval;
+            }
+            loopTasks(power, rx, ack, led, sensor, report, legacy);
+        }
+
+        EXPECT_EQ(radio.received, rx.read);
+        EXPECT_EQ(radio.received, ack.read);
+        EXPECT_NEAR(100, led.runs, 1);
+        EXPECT_NEAR(10, sensor.runs, 1);
+        EXPECT_NEAR(1, report.runs, 1);
+    }
+};
+
+TEST(TasksLoopTest, event_driven_tasks_reduce_awake_time) {
+    SimEventNode<false> polling;
+    polling.simulateTenSeconds();
+    SimEventNode<true> events;
+    events.simulateTenSeconds();
+
+    std::cout << "Per 10s on a 6-task node: " << polling.power.iterations << " iterations, "
+              << polling.counter.loops << " loop() calls, " << polling.counter.cycles << " cycles when polling; "
+              << events.power.iterations << " iterations, " << events.counter.loops << " loop() calls, "
+              << events.counter.cycles << " cycles when event-driven." << std::endl;
+
+    EXPECT_EQ(polling.power.iterations, events.power.iterations);
+    EXPECT_LT(events.counter.loops, polling.counter.loops / 4);
+    EXPECT_LT(events.counter.cycles, polling.counter.cycles / 2);
+}
+
+/** Advances a mocked TCNT1 by a fixed amount in each of its methods */
+struct TimedMockTask {
+    uint16_t stateCounts;
+    uint16_t loopCounts;
+
+    TaskState getTaskState() {
+        TCNT1.set(TCNT1.get() + stateCounts);
+        return TaskState::idle();
+    }
+
+    void loop() {
+        TCNT1.set(TCNT1.get() + loopCounts);
+    }
+};
+
+TEST(TasksLoopTest, profiling_accumulates_TCNT1_counts_per_task_slot) {
+    auto power = MockPower();
+    TimedMockTask a = { 10, 100 };
+    TimedMockTask b = { 20, 300 };
+    clearTaskProfile();
+    TCNT1.set(0xFF00); // should cope with timer wraparound
+
+    loopTasks(power, a, b);
+    b.loopCounts = 500;
+    loopTasks(power, a, b);
+    printTaskProfile();
+
+    const auto &profiles = TasksImpl::TaskProfiler<>::profiles;
+    EXPECT_EQ(2, profiles[0].getTaskState.count);
+    EXPECT_EQ(20u, profiles[0].getTaskState.total);
+    EXPECT_EQ(10, profiles[0].getTaskState.max);
+    EXPECT_EQ(2, profiles[0].loop.count);
+    EXPECT_EQ(200u, profiles[0].loop.total);
+    EXPECT_EQ(100, profiles[0].loop.max);
+    EXPECT_EQ(2, profiles[1].getTaskState.count);
+    EXPECT_EQ(40u, profiles[1].getTaskState.total);
+    EXPECT_EQ(2, profiles[1].loop.count);
+    EXPECT_EQ(800u, profiles[1].loop.total);
+    EXPECT_EQ(500, profiles[1].loop.max);
+    EXPECT_EQ(0, profiles[2].getTaskState.count);
+}
+
+TEST(TasksLoopTest, task_timing_saturates_count_and_total_together) {
+    TasksImpl::TaskTiming timing = {};
+    for (uint32_t i = 0; i < 70000; i++) {
+        timing.add(i < 0xFFFF ? 10 : 1000);
+    }
+    EXPECT_EQ(0xFFFF, timing.count);
+    EXPECT_EQ(10u * 0xFFFF, timing.total);
+    EXPECT_EQ(10, timing.max);
 }
 
+struct OrderedTask {
+    TaskState taskState;
+    char name;
+    std::string *log;
+
+    TaskState getTaskState() {
+        return taskState;
+    }
+
+    void loop() {
+        *log += name;
+    }
+};
+
+TEST(TasksLoopTest, by_deadline_invokes_most_urgent_task_first) {
+    auto power = MockPower();
+    std::string log;
+    OrderedTask a = { TaskState::idle(), 'a', &log };
+    OrderedTask b = { TaskState::busy(100_ms, SleepMode::IDLE), 'b', &log };
+    OrderedTask c = { TaskState::busy(5_ms, SleepMode::IDLE), 'c', &log };
+    OrderedTask d = { TaskState::busy(100_ms, SleepMode::IDLE), 'd', &log };
+    OrderedTask e = { TaskState::busy(0_ms, SleepMode::IDLE), 'e', &log };
+
+    loopTasksByDeadline(power, a, b, c, d, e);
+    EXPECT_EQ("ecbda", log);
+    EXPECT_TRUE(power.haveSlept);
+}
+
+/**
+ * A task that is released every [period] and must then be served within [tolerance]. Its TaskState
+ * reports that deadline, and its loop() takes [work] of real time when released.
+ */
+struct ReleasedTask {
+    MockRealTimer *rt;
+    uint32_t period;
+    uint32_t tolerance;
+    uint32_t work;
+    uint32_t release;
+    uint32_t runs = 0;
+    uint32_t maxLatency = 0;
+
+    ReleasedTask(MockRealTimer &_rt, Milliseconds p, Milliseconds t, Milliseconds w):
+        rt(&_rt),
+        period(toCountsOn<MockRealTimer>(p).getValue()),
+        tolerance(toCountsOn<MockRealTimer>(t).getValue()),
+        work(toCountsOn<MockRealTimer>(w).getValue()),
+        release(period) {}
+
+    TaskState getTaskState() {
+        const uint32_t deadline = release + tolerance;
+        const uint32_t now = rt->counts();
+        return TaskState(some(toMillisOn<MockRealTimer>(Counts(deadline > now ? deadline - now : 0))), SleepMode::IDLE);
+    }
+
+    void loop() {
+        const uint32_t now = rt->counts();
+        if (now >= release) {
+            maxLatency = std::max(maxLatency, now - release);
+            runs++;
+            release += period;
+            rt->c += work;
+        }
+    }
+};
+
+template <bool byDeadline>
+struct OverloadedNode {
+    MockRealTimer rt;
+    MockPower power;
+    ReleasedTask ds18x20 = { rt, 50_ms, 40_ms, 10_ms };
+    ReleasedTask espForward = { rt, 50_ms, 40_ms, 10_ms };
+    ReleasedTask display = { rt, 50_ms, 40_ms, 10_ms };
+    ReleasedTask rx = { rt, 20_ms, 0_ms, 0_ms };
+
+    void simulateSecond() {
+        auto budget = taskBudget(rt, 5_ms);
+        const uint32_t end = toCountsOn<MockRealTimer>(1_s).getValue();
+        const uint32_t idle = toCountsOn<MockRealTimer>(1_ms).getValue();
+        while (rt.counts() < end) {
+            if (byDeadline) {
+                loopTasksByDeadline(power, budget, ds18x20, espForward, display, rx);
+            } else {
+                loopTasks(power, ds18x20, espForward, display, rx);
+            }
+            rt.c += idle;
+        }
+        // the last iteration can overrun the second by up to 30ms
+        EXPECT_NEAR(20, ds18x20.runs, 1);
+        EXPECT_NEAR(20, espForward.runs, 1);
+        EXPECT_NEAR(20, display.runs, 1);
+        EXPECT_NEAR(51, rx.runs, 2);
+    }
+};
+
+TEST(TasksLoopTest, by_deadline_with_budget_bounds_latency_of_urgent_task_under_overload) {
+    OverloadedNode<false> fixed;
+    fixed.simulateSecond();
+    OverloadedNode<true> edf;
+    edf.simulateSecond();
+
+    const uint32_t fixedMs = toMillisOn<MockRealTimer>(Counts(fixed.rx.maxLatency)).getValue();
+    const uint32_t edfMs = toMillisOn<MockRealTimer>(Counts(edf.rx.maxLatency)).getValue();
+    std::cout << "Max latency of urgent task behind 3x 10ms tasks: " << fixedMs << "ms in argument order, "
+              << edfMs << "ms by deadline with 5ms budget." << std::endl;
+
+    EXPECT_GE(fixedMs, 20u);
+    EXPECT_LE(edfMs, 11u);
+}
+
+TEST(TasksLoopTest, by_deadline_defers_tasks_beyond_budget_without_sleeping) {
+    MockRealTimer rt;
+    MockPower power;
+    ReleasedTask slow1 = { rt, 10_ms, 0_ms, 10_ms };
+    ReleasedTask slow2 = { rt, 10_ms, 5_ms, 2_ms };
+    auto budget = taskBudget(rt, 5_ms);
+    rt.c = slow1.release;
+
+    loopTasksByDeadline(power, budget, slow2, slow1);
+    EXPECT_EQ(1u, slow1.runs);
+    EXPECT_EQ(0u, slow2.runs);
+    EXPECT_FALSE(power.haveSlept);
+    EXPECT_TRUE(budget.hasDeferred());
+
+    loopTasksByDeadline(power, budget, slow2, slow1);
+    EXPECT_EQ(1u, slow2.runs);
+    EXPECT_FALSE(budget.hasDeferred());
+    EXPECT_TRUE(power.haveSlept);
+}
+
+TEST(TasksLoopTest, by_deadline_always_invokes_most_urgent_task_even_without_budget) {
+    MockRealTimer rt;
+    MockPower power;
+    std::string log;
+    OrderedTask a = { TaskState::busy(100_ms, SleepMode::IDLE), 'a', &log };
+    OrderedTask b = { TaskState::busy(5_ms, SleepMode::IDLE), 'b', &log };
+    auto budget = taskBudget(rt, 0_counts);
+
+    loopTasksByDeadline(power, budget, a, b);
+    EXPECT_EQ("b", log);
+    EXPECT_TRUE(budget.hasDeferred());
+    EXPECT_FALSE(power.haveSlept);
+}
+
+}
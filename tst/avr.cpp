@@ -10,7 +10,12 @@ uint8_t sfr_mem[256];
 
 uint8_t eeprom_contents[1024];
 
+std::function<void(volatile void *)> onRegister8_change = nullptr;
+
 void HAL::Register8_onChange(volatile void *address) {
+    if (onRegister8_change != nullptr) {
+        onRegister8_change(address);
+    }
 }
 
 uint16_t _crc16_update(uint16_t crc, uint8_t a) {